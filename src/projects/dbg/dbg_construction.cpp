@@ -4,9 +4,160 @@
 
 using namespace hashing;
 using namespace dbg;
+bool JunctionFinding::blocked_bloom = false;
+bool JunctionFinding::save_filter = false;
+JunctionEngine JunctionFinding::engine = JunctionEngine::Bloom;
+
+template<class Filter>
+static void finishFilling(logging::Logger &logger, Filter &filter, size_t threads) {
+    std::pair<size_t, size_t> bits = filter.count_bits();
+    logger.info() << "Filled " << bits.first << " bits out of " << bits.second << std::endl;
+    logger.info() << "Finished filling bloom filter. Selecting junctions." << std::endl;
+}
+
+static void finishFilling(logging::Logger &logger, PartitionedHashSet &kmers, size_t threads) {
+    logging::TimeSpace t;
+    kmers.build(threads);
+    logger.info() << "Collected " << kmers.size() << " distinct k+1-mers using " << kmers.memory() / 1024 / 1024
+                  << "Mb of memory. Selecting junctions." << std::endl;
+    cout << "PartitionedHashSet::build(size_t " << threads << ") time: " << t.get() << endl;
+}
+
+//Filled bloom filter table is saved so that junction selection can be restarted without filling it again
+template<class Filter>
+static bool loadFilter(logging::Logger &logger, Filter &filter, const std::experimental::filesystem::path &file,
+                       uint64_t tag) {
+    MappedArray<unsigned char> table(file, tag);
+    if(!table.valid() || table.size() != filter.table_size()) {
+        logger.info() << "No valid bloom filter checkpoint found in " << file << std::endl;
+        return false;
+    }
+    filter.assign_table(table.data(), table.size());
+    logger.info() << "Loaded filled bloom filter from " << file << std::endl;
+    return true;
+}
+
+template<class Filter>
+static void saveFilter(logging::Logger &logger, const Filter &filter, const std::experimental::filesystem::path &file,
+                       uint64_t tag) {
+    logging::TimeSpace t;
+    WriteBinaryArray(file, filter.table(), filter.table_size(), tag);
+    logger.info() << "Saved filled bloom filter to " << file << std::endl;
+    cout << "saveFilter(" << file << ") time: " << t.get() << endl;
+}
+
+//Filter is BloomFilter, BlockedBloomFilter or PartitionedHashSet with exact k+1-mer set.
+//If checkpoint is not empty, the filled filter is loaded from it when resume is set and it is valid for the tag
+//and saved to it otherwise. Exact set has no table to checkpoint, so checkpoint must be empty for it.
+template<class Filter>
+static std::vector<hashing::htype> selectJunctions(logging::Logger &logger, Filter &filter,
+                                                   const std::vector<Sequence> &split_disjointigs,
+                                                   const hashing::RollingHash &hasher, size_t threads,
+                                                   const std::experimental::filesystem::path &checkpoint,
+                                                   bool resume, uint64_t tag) {
+//    Bloom filter only answers membership queries, so 64-bit hashes of k+1-mers are enough for its keys
+    const hashing::BasicRollingHash<htype64> narrow_hasher = hasher.narrow<htype64>();
+    const hashing::BasicRollingHash<htype64> ehasher = narrow_hasher.extensionHash();
+    std::function<void(size_t, const Sequence &)> task = [&filter, &ehasher](size_t pos, const Sequence & seq) {
+        if(seq.size() < ehasher.getK())
+            return;
+        hashing::BasicKmerScanner<htype64> scanner(ehasher, seq);
+        std::vector<hashing::BasicHashedKmer<htype64>> kmers;
+        while (scanner.nextBlock(kmers)) {
+            for (const hashing::BasicHashedKmer<htype64> &kmer : kmers) {
+                filter.insert(kmer.hash());
+//                filter.delayedInsert(kmer.hash());
+            }
+        }
+    };
+    constexpr bool checkpointable = !std::is_same<Filter, PartitionedHashSet>::value;
+    VERIFY(checkpointable || checkpoint.empty());
+    bool loaded = false;
+    if constexpr (checkpointable)
+        loaded = !checkpoint.empty() && resume && loadFilter(logger, filter, checkpoint, tag);
+    if(!loaded) {
+        logger.info() << "Filling filter with k+1-mers." << std::endl;
+//        ParallelProcessor<Sequence> fill_processor(task, logger, threads);
+//        fill_processor.doAfter = [&filter, threads]() {
+//            filter.dump(threads);
+//        };
+//        fill_processor.processRecords(split_disjointigs.begin(), split_disjointigs.end());
+        processRecords(split_disjointigs.begin(), split_disjointigs.end(), logger, threads, task);
+        finishFilling(logger, filter, threads);
+        if constexpr (checkpointable) {
+            if(!checkpoint.empty())
+                saveFilter(logger, filter, checkpoint, tag);
+        }
+    }
+    ParallelRecordCollector<hashing::htype> junctions(threads);
+    std::function<void(size_t, const Sequence &)> junk_task = [&filter, &hasher, &narrow_hasher, &junctions](size_t pos, const Sequence & seq) {
+        hashing::BasicKmerScanner<htype> scanner(hasher, seq);
+        std::vector<hashing::BasicHashedKmer<htype>> kmers;
+//        Right extensions of a k-mer are followed by its left extensions. All of them are looked up in one batch.
+        std::vector<htype64> extensions;
+        std::vector<unsigned char> found;
+        size_t cnt = 0;
+        while (scanner.nextBlock(kmers)) {
+            extensions.resize(kmers.size() * 8);
+            found.resize(kmers.size() * 8);
+            for (size_t i = 0; i < kmers.size(); i++) {
+//                Narrow hash of a k-mer is the low 64 bits of its wide hash, so the k-mer is not scanned twice
+                htype64 fhash = htype64(kmers[i].fhash);
+                htype64 rhash = htype64(kmers[i].rhash);
+                for (unsigned char c = 0; c < 4u; c++) {
+                    extensions[i * 8 + c] = std::min(narrow_hasher.append(fhash, c),
+                                                     narrow_hasher.prepend(rhash, c ^ 3u));
+                    extensions[i * 8 + 4 + c] = std::min(narrow_hasher.prepend(fhash, c),
+                                                         narrow_hasher.append(rhash, c ^ 3u));
+                }
+            }
+            filter.containsBatch(extensions.data(), extensions.size(), found.data());
+            for (size_t i = 0; i < kmers.size(); i++) {
+                size_t cnt1 = 0;
+                size_t cnt2 = 0;
+                for (unsigned char c = 0; c < 4u; c++) {
+                    cnt1 += found[i * 8 + c];
+                    cnt2 += found[i * 8 + 4 + c];
+                }
+                if (cnt1 != 1 || cnt2 != 1) {
+                    cnt += 1;
+                    junctions.emplace_back(kmers[i].hash());
+                }
+                VERIFY(cnt1 <= 4 && cnt2 <= 4);
+            }
+        }
+        if (cnt == 0) {
+            junctions.emplace_back(KWH(hasher, seq, 0).hash());
+        }
+    };
+
+    processRecords(split_disjointigs.begin(), split_disjointigs.end(), logger, threads, junk_task);
+    return junctions.collect();
+}
+
+//Identifies filter type and the k+1-mers a filter is filled with, so that a checkpoint of other disjointigs or
+//with other parameters is not loaded. Checksums cover the whole packed sequences of disjointigs.
+static uint64_t filterTag(const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher,
+                          size_t table_size, uint64_t filter_type, size_t threads) {
+    std::vector<uint64_t> checksums(disjointigs.size());
+#pragma omp parallel for schedule(dynamic, 16) num_threads(threads)
+    for(size_t i = 0; i < disjointigs.size(); i++) {
+        const Sequence &seq = disjointigs[i];
+        std::vector<uint64_t> packed(packing::Words(seq.size()));
+        seq.copyPacked(packed.data());
+        if(seq.size() % 32 != 0)
+            packed.back() &= (uint64_t(1) << (2 * (seq.size() % 32))) - 1;
+        checksums[i] = BinaryChecksum(reinterpret_cast<const char *>(packed.data()), packed.size() * sizeof(uint64_t));
+    }
+    uint64_t res = hashing::mix64(hasher.getK() ^ hashing::mix64(table_size ^ hashing::mix64(filter_type)));
+    for(size_t i = 0; i < disjointigs.size(); i++)
+        res = hashing::mix64(hashing::mix64(res ^ disjointigs[i].size()) ^ checksums[i]);
+    return res;
+}
+
 std::vector<hashing::htype>
 findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher,
-              size_t threads) {
+              size_t threads, const std::experimental::filesystem::path &checkpoint, bool resume) {
     logging::TimeSpace t;
     bloom_parameters parameters;
     parameters.projected_element_count = std::max(total_size(disjointigs) - hasher.getK() * disjointigs.size(), size_t(1000));
@@ -25,59 +176,26 @@ findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs,
     parameters.false_positive_probability = 0.0001;
     VERIFY(!!parameters);
     parameters.compute_optimal_parameters();
-    BloomFilter filter(parameters);
-//    DelayedBloomFilter filter(parameters, threads);
-    const hashing::RollingHash ehasher = hasher.extensionHash();
-    std::function<void(size_t, const Sequence &)> task = [&filter, &ehasher](size_t pos, const Sequence & seq) {
-        if(seq.size() < ehasher.getK())
-            return;
-        hashing::KWH kmer(ehasher, seq, 0);
-        while (true) {
-            filter.insert(kmer.hash());
-//            filter.delayedInsert(kmer.hash());
-            if (!kmer.hasNext())
-                break;
-            kmer = kmer.next();
-        }
-    };
-    logger.info() << "Filling bloom filter with k+1-mers." << std::endl;
-    std::cout << "Bloom Filter table size: " << filter.table_size() << std::endl;
-//    ParallelProcessor<Sequence> fill_processor(task, logger, threads);
-//    fill_processor.doAfter = [&filter, threads]() {
-//        filter.dump(threads);
-//    };
-//    fill_processor.processRecords(split_disjointigs.begin(), split_disjointigs.end());
-    processRecords(split_disjointigs.begin(), split_disjointigs.end(), logger, threads, task);
-    std::pair<size_t, size_t> bits = filter.count_bits();
-    logger.info() << "Filled " << bits.first << " bits out of " << bits.second << std::endl;
-    logger.info() << "Finished filling bloom filter. Selecting junctions." << std::endl;
-    ParallelRecordCollector<hashing::htype> junctions(threads);
-    std::function<void(size_t, const Sequence &)> junk_task = [&filter, &hasher, &junctions](size_t pos, const Sequence & seq) {
-        KWH kmer(hasher, seq, 0);
-        size_t cnt = 0;
-        while (true) {
-            size_t cnt1 = 0;
-            size_t cnt2 = 0;
-            for (unsigned char c = 0; c < 4u; c++) {
-                cnt1 += filter.contains(kmer.extendRight(c));
-                cnt2 += filter.contains(kmer.extendLeft(c));
-            }
-            if (cnt1 != 1 || cnt2 != 1) {
-                cnt += 1;
-                junctions.emplace_back(kmer.hash());
-            }
-            VERIFY(cnt1 <= 4 && cnt2 <= 4);
-            if (!kmer.hasNext())
-                break;
-            kmer = kmer.next();
-        }
-        if (cnt == 0) {
-            junctions.emplace_back(KWH(hasher, seq, 0).hash());
-        }
-    };
-
-    processRecords(split_disjointigs.begin(), split_disjointigs.end(), logger, threads, junk_task);
-    std::vector<hashing::htype> res = junctions.collect();
+    std::vector<hashing::htype> res;
+    if(JunctionFinding::engine == JunctionEngine::Exact) {
+        logger.info() << "Selecting junctions using exact set of k+1-mers." << std::endl;
+        if(!checkpoint.empty())
+            logger.info() << "Exact set of k+1-mers is not checkpointed." << std::endl;
+        PartitionedHashSet kmers(threads);
+        res = selectJunctions(logger, kmers, split_disjointigs, hasher, threads, {}, false, 0);
+    } else if(JunctionFinding::blocked_bloom) {
+        logger.info() << "Using blocked bloom filter." << std::endl;
+        BlockedBloomFilter filter(parameters);
+        std::cout << "Bloom Filter table size: " << filter.table_size() << std::endl;
+        res = selectJunctions(logger, filter, split_disjointigs, hasher, threads, checkpoint, resume,
+                              checkpoint.empty() ? 0 : filterTag(disjointigs, hasher, filter.table_size(), 2, threads));
+    } else {
+        BloomFilter filter(parameters);
+//        DelayedBloomFilter filter(parameters, threads);
+        std::cout << "Bloom Filter table size: " << filter.table_size() << std::endl;
+        res = selectJunctions(logger, filter, split_disjointigs, hasher, threads, checkpoint, resume,
+                              checkpoint.empty() ? 0 : filterTag(disjointigs, hasher, filter.table_size(), 1, threads));
+    }
     __gnu_parallel::sort(res.begin(), res.end());
     res.erase(std::unique(res.begin(), res.end()), res.end());
     logger.info() << "Collected " << res.size() << " junctions." << std::endl;
@@ -90,14 +208,15 @@ SparseDBG constructDBG(logging::Logger &logger, const std::vector<hashing::htype
              const RollingHash &hasher, size_t threads) {
     logging::TimeSpace t;
     logger.info() << "Starting DBG construction." << std::endl;
-    SparseDBG dbg(vertices.begin(), vertices.end(), hasher);
-    logger.info() << "Vertices created." << std::endl;
+    SparseDBG dbg(vertices, hasher, threads);
+    logger.info() << "Vertices created. Vertex table uses " << dbg.vertexTableMemory() / 1024 / 1024 << "Mb" << std::endl;
     std::function<void(size_t, Sequence &)> edge_filling_task = [&dbg](size_t pos, Sequence & seq) {
         dbg.processRead(seq);
     };
     processRecords(disjointigs.begin(), disjointigs.end(), logger, threads, edge_filling_task);
 
-    logger.info() << "Filled dbg edges. Adding hanging vertices " << std::endl;
+    logger.info() << "Filled dbg edges. Edge arena uses " << dbg.edgeArenaMemory() / 1024 / 1024 << "Mb" << std::endl;
+    logger.info() << "Adding hanging vertices " << std::endl;
     ParallelRecordCollector<std::pair<Vertex*, Edge *>> tips(threads);
 
     std::function<void(size_t, std::pair<const hashing::htype, Vertex> &)> task =
@@ -123,6 +242,7 @@ SparseDBG constructDBG(logging::Logger &logger, const std::vector<hashing::htype
     logger.info() << "Merging unbranching paths" << std::endl;
     mergeAll(logger, dbg, threads);
     logger.info() << "Ended merging edges. Resulting size " << dbg.size() << std::endl;
+    dbg.shareSequences(logger, threads);
     logger.trace() << "Statistics for de Bruijn graph:" << std::endl;
     printStats(logger, dbg);
     cout << "constructDBG(logging::Logger &logger, const std::vector<hashing::htype> &" << vertices.size() << ", const std::vector<Sequence> &" << disjointigs.size() << ", "
@@ -130,14 +250,12 @@ SparseDBG constructDBG(logging::Logger &logger, const std::vector<hashing::htype
     return std::move(dbg);
 }
 
-inline void writeHashs(std::ostream &os, const std::vector<htype> &hash_list) {
-    os << "hashes " << hash_list.size() << std::endl;
-    for (htype h : hash_list) {
-        os << h << std::endl;
-    }
+//Junction hashes are stored as a binary array tagged with k. Text files of older versions can still be read.
+inline void writeHashs(const std::experimental::filesystem::path &file, const std::vector<htype> &hash_list, size_t k) {
+    WriteBinaryArray(file, hash_list, k);
 }
 
-inline std::vector<htype> readHashs(std::istream &is) {
+inline std::vector<htype> readTextHashs(std::istream &is) {
     std::vector<htype> result;
     std::string first;
     is >> first;
@@ -161,6 +279,17 @@ inline std::vector<htype> readHashs(std::istream &is) {
     return std::move(result);
 }
 
+inline std::vector<htype> readHashs(const std::experimental::filesystem::path &file, size_t k) {
+    if(!IsBinaryArray(file)) {
+        std::ifstream is;
+        is.open(file);
+        return readTextHashs(is);
+    }
+    MappedArray<htype> hashes(file, k);
+    VERIFY_MSG(hashes.valid(), "Incorrect or corrupted vertex hash file " + file.string());
+    return {hashes.begin(), hashes.end()};
+}
+
 SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t w, const io::Library &lib,
                       const std::experimental::filesystem::path &dir, size_t threads, const string &disjointigs_file,
                       const string &vertices_file) {
@@ -169,7 +298,7 @@ SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t
     if (disjointigs_file == "none") {
         std::function<void()> task = [&logger, &lib, &threads, &w, &dir, &hasher]() {
             std::vector<hashing::htype> hash_list;
-            hash_list = constructMinimizers(logger, lib, threads, hasher, w);
+            hash_list = constructMinimizers(logger, lib, threads, hasher, w, dir);
             std::vector<Sequence> disjointigs = constructDisjointigs(hasher, w, lib, hash_list, threads, logger);
             hash_list.clear();
             std::ofstream df;
@@ -192,18 +321,21 @@ SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t
         disjointigs.push_back(reader.read().makeSequence());
     }
     std::vector<hashing::htype> vertices;
+    VERIFY_MSG(vertices_file == "none" || std::experimental::filesystem::exists(vertices_file),
+               "File with vertex hashes " + vertices_file + " does not exist");
     if (vertices_file == "none") {
-        vertices = findJunctions(logger, disjointigs, hasher, threads);
-        std::ofstream os;
-        os.open(std::string(dir.c_str()) + "/vertices.save");
-        writeHashs(os, vertices);
-        os.close();
+//        Filled filter is only saved on request or when disjointigs are loaded, i.e. junction selection is restarted
+        bool resume = disjointigs_file != "none";
+        std::experimental::filesystem::path checkpoint;
+        if(resume || JunctionFinding::save_filter)
+            checkpoint = dir / "junction_filter.bin";
+        vertices = findJunctions(logger, disjointigs, hasher, threads, checkpoint, resume);
+        writeHashs(dir / "vertices.save", vertices, hasher.getK());
+        if(!checkpoint.empty())
+            std::experimental::filesystem::remove(checkpoint);
     } else {
         logger.info() << "Loading vertex hashs from file " << vertices_file << std::endl;
-        std::ifstream is;
-        is.open(vertices_file);
-        vertices = readHashs(is);
-        is.close();
+        vertices = readHashs(vertices_file, hasher.getK());
     }
     cout << "without construction, DBGPipeline(logging::Logger &logger, const RollingHash &" << hasher.getK() << ", size_t " << w << ", const io::Library &lib, "
                       << "const std::experimental::filesystem::path &" << dir << ", size_t " << threads << ", const string &" << disjointigs_file << ", "
@@ -9,14 +9,40 @@
 #include "common/rolling_hash.hpp"
 #include "sequences/sequence.hpp"
 #include "common/bloom_filter.hpp"
+#include "common/partitioned_hash_set.hpp"
+#include "common/binary_array.hpp"
 #include "common/output_utils.hpp"
 #include "common/logging.hpp"
 #include "common/simple_computation.hpp"
 #include "common/omp_utils.hpp"
 #include <wait.h>
 
+enum class JunctionEngine {
+    Bloom, Exact
+};
+
+//Junctions are selected by looking up extensions of k-mers in a set of k+1-mers of disjointigs. Bloom engine uses
+//a bloom filter, false positives of which create extra vertices. Blocked bloom filter keeps all bits of a k+1-mer in
+//one cache line, see BlockedBloomFilter. Exact engine stores all distinct k+1-mer hashes in a PartitionedHashSet.
+struct JunctionFinding {
+    static bool blocked_bloom;
+//    Keep filled bloom filter on disk until junctions are saved, so that a stopped run can restart without filling it
+    static bool save_filter;
+    static JunctionEngine engine;
+
+    static JunctionEngine parseEngine(const std::string &name) {
+        if(name == "bloom")
+            return JunctionEngine::Bloom;
+        VERIFY_MSG(name == "exact", "Unknown junction engine " + name);
+        return JunctionEngine::Exact;
+    }
+};
+
+//Filled bloom filter is saved to checkpoint unless checkpoint path is empty. With resume a valid saved filter is loaded
+//instead.
 std::vector<hashing::htype> findJunctions(logging::Logger & logger, const std::vector<Sequence>& disjointigs,
-                                 const hashing::RollingHash &hasher, size_t threads);
+                                 const hashing::RollingHash &hasher, size_t threads,
+                                 const std::experimental::filesystem::path &checkpoint = {}, bool resume = false);
 dbg::SparseDBG constructDBG(logging::Logger & logger, const std::vector<hashing::htype> &vertices,
                        const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher, size_t threads);
 dbg::SparseDBG DBGPipeline(logging::Logger & logger, const hashing::RollingHash &hasher, size_t w, const io::Library &lib,
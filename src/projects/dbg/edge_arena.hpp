@@ -0,0 +1,156 @@
+#pragma once
+
+#include "common/verify.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dbg {
+    /*
+     * Storage of graph edges addressed by 32-bit ids. Edges live in blocks of block_size objects that are never moved,
+     * so references to edges stay valid until the edge is released, regardless of insertions into the graph.
+     * Blocks are created on demand from a fixed directory, so allocation is lock-free and can run from many threads.
+     * Released ids are reused by later allocations. Memory of blocks is kept for the lifetime of the arena.
+     */
+    template<class E>
+    class EdgeArena {
+    public:
+        typedef uint32_t id_type;
+        static const id_type NONE = id_type(-1);
+    private:
+        static const size_t block_bits = 16;
+        static const size_t block_size = size_t(1) << block_bits;
+        static const size_t max_blocks = (size_t(1) << 32u) / block_size;
+        typedef typename std::aligned_storage<sizeof(E), alignof(E)>::type Cell;
+
+        std::unique_ptr<std::atomic<Cell *>[]> blocks;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> released{0};
+        std::vector<id_type> free_ids;
+        std::mutex free_lock;
+
+        Cell *block(size_t n) {
+            Cell *res = blocks[n].load(std::memory_order_acquire);
+            if(res != nullptr)
+                return res;
+            Cell *created = new Cell[block_size];
+            if(blocks[n].compare_exchange_strong(res, created, std::memory_order_acq_rel))
+                return created;
+            delete[] created;
+            return res;
+        }
+
+    public:
+        EdgeArena() : blocks(new std::atomic<Cell *>[max_blocks]) {
+            for(size_t i = 0; i < max_blocks; i++)
+                blocks[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        EdgeArena(const EdgeArena &) = delete;
+
+        ~EdgeArena() {
+            for(size_t i = 0; i < max_blocks; i++)
+                delete[] blocks[i].load();
+        }
+
+        template<class... Args>
+        id_type emplace(Args &&... args) {
+            id_type id = NONE;
+            if(released.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard<std::mutex> guard(free_lock);
+                if(!free_ids.empty()) {
+                    id = free_ids.back();
+                    free_ids.pop_back();
+                    released--;
+                }
+            }
+            if(id == NONE) {
+                size_t n = next++;
+                VERIFY_MSG(n < NONE, "Number of graph edges exceeds 32-bit ids");
+                id = n;
+            }
+            new(&block(id >> block_bits)[id & (block_size - 1)]) E(std::forward<Args>(args)...);
+            return id;
+        }
+
+        void release(id_type id) {
+            (*this)[id].~E();
+            std::lock_guard<std::mutex> guard(free_lock);
+            free_ids.push_back(id);
+            released++;
+        }
+
+        E &operator[](id_type id) const {
+            Cell *b = blocks[id >> block_bits].load(std::memory_order_acquire);
+            return *reinterpret_cast<E *>(&b[id & (block_size - 1)]);
+        }
+
+        size_t size() const {
+            return next - released;
+        }
+
+        size_t memory() const {
+            return (next + block_size - 1) / block_size * block_size * sizeof(E) + free_ids.capacity() * sizeof(id_type);
+        }
+    };
+
+    /*
+     * List of edge ids that keeps up to inline_size ids without allocation. Outgoing edges of a vertex of a de Bruijn
+     * graph start with different nucleotides, so there are at most 4 of them, but graphs with minimizers of raw reads
+     * as vertices can have more, then ids are moved to the heap.
+     */
+    class EdgeIdList {
+    public:
+        typedef uint32_t id_type;
+    private:
+        static const size_t inline_size = 4;
+        union {
+            id_type small[inline_size];
+            id_type *large;
+        };
+        uint32_t size_ = 0;
+        uint32_t capacity_ = inline_size;
+    public:
+        EdgeIdList() {
+        }
+
+        EdgeIdList(const EdgeIdList &) = delete;
+
+        ~EdgeIdList() {
+            if(capacity_ > inline_size)
+                delete[] large;
+        }
+
+        id_type *data() {return capacity_ > inline_size ? large : small;}
+        const id_type *data() const {return capacity_ > inline_size ? large : small;}
+        size_t size() const {return size_;}
+        id_type operator[](size_t ind) const {return data()[ind];}
+
+        void push_back(id_type id) {
+            if(size_ == capacity_) {
+                id_type *grown = new id_type[capacity_ * 2];
+                std::copy(data(), data() + size_, grown);
+                if(capacity_ > inline_size)
+                    delete[] large;
+                large = grown;
+                capacity_ *= 2;
+            }
+            data()[size_] = id;
+            size_++;
+        }
+
+        void clear() {
+            if(capacity_ > inline_size)
+                delete[] large;
+            capacity_ = inline_size;
+            size_ = 0;
+        }
+    };
+}
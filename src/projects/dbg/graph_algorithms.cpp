@@ -177,16 +177,16 @@ namespace dbg {
         cout << "mergeLoop time: " << t.get() << endl;
     }
 
-    void MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge) {
+    bool MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge) {
         //logging::TimeSpace t;
         Path path = Path::WalkForward(edge);
         Vertex &end = path.finish().rc();
         if (path.size() > 1 && end.hash() >= start.hash()) {
             VERIFY(start.seq.size() > 0)
             VERIFY(end.seq.size() > 0);
+            if (!start.sharesLock(end) && !end.tryLock())
+                return false;
             Sequence newSeq(path.Seq());
-            if (start != end)
-                end.lock();
             size_t cov = 0;
             for (size_t i = 0; i + 1 < path.size(); i++) {
 //            path[i].end()->clear();
@@ -199,32 +199,41 @@ namespace dbg {
             Edge &rc_new_edge = end.addEdgeLockFree(Edge(&end, &start.rc(), (!newSeq).Subseq(start.seq.size())));
             new_edge.incCov(cov - new_edge.intCov());
             rc_new_edge.incCov(cov - rc_new_edge.intCov());
-            if (start != end)
+            if (!start.sharesLock(end))
                 end.unlock();
         }
         //cout << "MergeEdge time: " << t.get() << endl;
+        return true;
     }
 
     void mergeLinearPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads) {
         logging::TimeSpace t;
         logger.trace() << "Merging linear unbranching paths" << std::endl;
+//        Paths which end vertex was locked by another thread are merged after all others in one thread
+        ParallelRecordCollector<std::pair<Vertex *, Edge *>> postponed(threads);
         std::function<void(size_t, std::pair<const htype, Vertex> &)> task =
-                [&sdbg](size_t pos, std::pair<const htype, Vertex> &pair) {
+                [&sdbg, &postponed](size_t pos, std::pair<const htype, Vertex> &pair) {
                     Vertex &start = pair.second;
                     if (!start.isJunction())
                         return;
                     start.lock();
                     for (Edge &edge: start) {
-                        MergeEdge(sdbg, start, edge);
+                        if (!MergeEdge(sdbg, start, edge))
+                            postponed.emplace_back(&start, &edge);
                     }
                     start.unlock();
                     start.rc().lock();
                     for (Edge &edge: start.rc()) {
-                        MergeEdge(sdbg, start.rc(), edge);
+                        if (!MergeEdge(sdbg, start.rc(), edge))
+                            postponed.emplace_back(&start.rc(), &edge);
                     }
                     start.rc().unlock();
                 };
         processObjects(sdbg.begin(), sdbg.end(), logger, threads, task);
+        for (std::pair<Vertex *, Edge *> &rec : postponed) {
+            bool merged = MergeEdge(sdbg, *rec.first, *rec.second);
+            VERIFY(merged);
+        }
         logger.trace() << "Finished merging linear unbranching paths" << std::endl;
         cout << "mergeLinearPaths(logging::Logger &logger, SparseDBG &" << sdbg.size() << ", size_t " << threads << ") atime: " << t.get() << endl;
         
@@ -252,7 +261,6 @@ namespace dbg {
                     if (ismin) {
                         loops.emplace_back(start.hash());
                     }
-                    start.unlock();
                 };
         processObjects(sdbg.begin(), sdbg.end(), logger, threads, task);
         logger.trace() << "Found " << loops.size() << " perfect loops" << std::endl;
@@ -365,6 +373,7 @@ namespace dbg {
         SparseDBG res(vertices.begin(), vertices.end(), hasher);
         reader.reset();
         FillSparseDBGEdges(res, sequences.begin(), sequences.end(), logger, threads, hasher.getK() + 1);
+        res.shareSequences(logger, threads);
         logger.info() << "Finished loading graph" << std::endl;
         cout << "LoadDBGFromFasta(const io::Library &lib, RollingHash &hasher, logging::Logger &logger, size_t " << threads << ") time: " << t.get() << endl;
         return std::move(res);
@@ -54,7 +54,8 @@ namespace dbg {
 
     void mergeLoop(Path path);
 
-    void MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge);
+//    Returns false if the path can not be merged now because the lock of its end vertex is taken by another thread
+    bool MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge);
 
     void mergeLinearPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads);
 
@@ -229,7 +229,7 @@ void RecordStorage::fill(I begin, I end, dbg::SparseDBG &dbg, size_t min_read_si
         cnt += cpath.size();
         tmpReads.emplace_back(pos, contig.id, cpath);
     };
-    processRecords(begin, end, logger, threads, read_task);
+    processRecordsPipelined(begin, end, logger, threads, read_task);
     reads.resize(tmpReads.size());
     for(auto &rec : tmpReads) {
         VERIFY(std::get<0>(rec) < reads.size());
@@ -0,0 +1,237 @@
+#include "graph_snapshot.hpp"
+#include "common/binary_array.hpp"
+#include "common/hash_utils.hpp"
+#include "sequences/packing_kernel.hpp"
+#include <memory>
+#include <unordered_map>
+
+using namespace dbg;
+
+namespace {
+    const uint64_t snapshot_version = 1;
+    const uint64_t NO_VERTEX = uint64_t(-1);
+
+    struct SnapshotVertex {
+        hashing::htype hash;
+        uint64_t kmer;
+        uint64_t first_edge;
+    };
+
+    struct SnapshotEdge {
+        uint64_t start;
+        uint64_t end;
+        uint64_t seq;
+        uint64_t size;
+        uint64_t cov;
+    };
+
+    struct SnapshotPath {
+        uint64_t start;
+        uint64_t edges;
+        uint64_t size;
+        uint64_t left;
+        uint64_t right;
+        uint64_t name;
+        uint64_t name_size;
+    };
+
+    uint64_t snapshotTag(size_t k) {
+        return hashing::mix64(hashing::mix64(snapshot_version) ^ k);
+    }
+
+//    Sequences start from a new word of the pool. Returns position in nucleotides.
+    uint64_t appendPacked(std::vector<uint64_t> &pool, const Sequence &seq) {
+        uint64_t pos = pool.size() * 32;
+        pool.resize(pool.size() + packing::Words(seq.size()));
+        seq.copyPacked(pool.data() + pos / 32);
+        return pos;
+    }
+
+    Sequence poolView(const Sequence &pool, uint64_t pos, size_t size) {
+        Sequence res = pool.Subseq(pos / 2, pos / 2 + size);
+        return pos % 2 == 0 ? res : !res;
+    }
+}
+
+bool dbg::IsGraphSnapshot(const std::experimental::filesystem::path &dir, size_t k) {
+    return std::experimental::filesystem::is_directory(dir) &&
+           MappedArray<SnapshotVertex>(dir / "vertices.bin", snapshotTag(k)).valid();
+}
+
+void dbg::SaveGraphSnapshot(logging::Logger &logger, const std::experimental::filesystem::path &dir, SparseDBG &dbg,
+                            const std::vector<RecordStorage *> &recs) {
+    logging::TimeSpace t;
+    logger.info() << "Saving graph snapshot to " << dir << std::endl;
+    const size_t k = dbg.hasher().getK();
+    const uint64_t tag = snapshotTag(k);
+    std::vector<Vertex *> vertex_list;
+    std::unordered_map<const Vertex *, uint64_t> vertex_ids;
+    for(auto &it : dbg) {
+        vertex_ids[&it.second] = vertex_list.size() * 2;
+        vertex_ids[&it.second.rc()] = vertex_list.size() * 2 + 1;
+        vertex_list.push_back(&it.second);
+    }
+//    Edge and its rc are reverse complement views of the same sequence
+    std::vector<uint64_t> pool;
+    std::unordered_map<const Edge *, uint64_t> edge_seqs;
+    for(Vertex *cvertex : vertex_list) {
+        for(Vertex *vertex : {cvertex, &cvertex->rc()}) {
+            for(Edge &edge : *vertex) {
+                if(edge_seqs.find(&edge) != edge_seqs.end())
+                    continue;
+                uint64_t pos = appendPacked(pool, vertex->seq + edge.seq);
+                edge_seqs[&edge] = pos * 2;
+//                Hanging edges that end outside of the graph have no rc
+                if(edge.end() == nullptr)
+                    continue;
+                Edge &rc_edge = edge.rc();
+                if(rc_edge != edge)
+                    edge_seqs[&rc_edge] = pos * 2 + 1;
+            }
+        }
+    }
+    std::vector<SnapshotVertex> vertices;
+    std::vector<SnapshotEdge> edges;
+    for(Vertex *cvertex : vertex_list) {
+        SnapshotVertex rec = {};
+        rec.hash = cvertex->hash();
+        rec.first_edge = edges.size();
+        if(cvertex->outDeg() > 0) {
+            const Edge &edge = (*cvertex)[0];
+            uint64_t seq = edge_seqs[&edge];
+            rec.kmer = seq % 2 == 0 ? seq : (seq / 2 + edge.size()) * 2 + 1;
+        } else if(cvertex->inDeg() > 0) {
+            const Edge &edge = cvertex->rc()[0];
+            uint64_t seq = edge_seqs[&edge];
+            rec.kmer = seq % 2 == 0 ? seq + 1 : (seq / 2 + edge.size()) * 2;
+        } else {
+            rec.kmer = appendPacked(pool, cvertex->seq) * 2;
+        }
+        vertices.emplace_back(rec);
+        for(Vertex *vertex : {cvertex, &cvertex->rc()}) {
+            for(Edge &edge : *vertex) {
+                uint64_t end = edge.end() == nullptr ? NO_VERTEX : vertex_ids[edge.end()];
+                edges.push_back({vertex_ids[vertex], end, edge_seqs[&edge], edge.size(), edge.intCov()});
+            }
+        }
+    }
+    std::vector<uint64_t> storages;
+    std::vector<SnapshotPath> paths;
+    std::vector<uint64_t> path_edges;
+    std::vector<char> names;
+    for(RecordStorage *recordStorage : recs) {
+        storages.push_back(recordStorage->size());
+        for(const AlignedRead &read : *recordStorage) {
+            SnapshotPath rec = {};
+            rec.name = names.size();
+            rec.name_size = read.id.size();
+            names.insert(names.end(), read.id.begin(), read.id.end());
+            if(read.path.valid()) {
+                rec.start = vertex_ids[&read.path.start()];
+                rec.edges = appendPacked(path_edges, read.path.cpath());
+                rec.size = read.path.size();
+                rec.left = read.path.leftSkip();
+                rec.right = read.path.rightSkip();
+            } else {
+                rec.start = NO_VERTEX;
+            }
+            paths.emplace_back(rec);
+        }
+    }
+    const std::experimental::filesystem::path tmp = dir.string() + ".tmp";
+    std::experimental::filesystem::remove_all(tmp);
+    std::experimental::filesystem::create_directories(tmp);
+    WriteBinaryArray(tmp / "sequences.bin", pool, tag);
+    WriteBinaryArray(tmp / "vertices.bin", vertices, tag);
+    WriteBinaryArray(tmp / "edges.bin", edges, tag);
+    WriteBinaryArray(tmp / "storages.bin", storages, tag);
+    WriteBinaryArray(tmp / "paths.bin", paths, tag);
+    WriteBinaryArray(tmp / "path_edges.bin", path_edges, tag);
+    WriteBinaryArray(tmp / "names.bin", names, tag);
+    std::experimental::filesystem::remove_all(dir);
+    std::experimental::filesystem::rename(tmp, dir);
+    logger.info() << "Saved " << vertices.size() << " vertices, " << edges.size() << " edges and " << paths.size()
+                  << " read paths" << std::endl;
+    cout << "SaveGraphSnapshot time: " << t.get() << endl;
+}
+
+SparseDBG dbg::LoadGraphSnapshot(logging::Logger &logger, const std::experimental::filesystem::path &dir,
+                                 hashing::RollingHash &hasher, size_t threads) {
+    logging::TimeSpace t;
+    logger.info() << "Loading graph snapshot from " << dir << std::endl;
+    const size_t k = hasher.getK();
+    const uint64_t tag = snapshotTag(k);
+    std::shared_ptr<MappedArray<uint64_t>> pool = std::make_shared<MappedArray<uint64_t>>(dir / "sequences.bin", tag);
+    MappedArray<SnapshotVertex> vertices(dir / "vertices.bin", tag);
+    MappedArray<SnapshotEdge> edges(dir / "edges.bin", tag);
+    VERIFY_MSG(pool->valid() && vertices.valid() && edges.valid(),
+               "Graph snapshot " + dir.string() + " is damaged or was saved for another k");
+    const Sequence pool_seq = Sequence::View(pool->data(), pool->size() * 32, pool);
+    std::vector<hashing::htype> hashes(vertices.size());
+    for(size_t i = 0; i < vertices.size(); i++)
+        hashes[i] = vertices.data()[i].hash;
+    SparseDBG dbg(hashes, hasher, threads);
+    std::vector<Vertex *> vertex_list(vertices.size());
+    omp_set_num_threads(threads);
+#pragma omp parallel for schedule(static)
+    for(size_t i = 0; i < vertices.size(); i++) {
+        Vertex &vertex = dbg.getVertex(vertices.data()[i].hash);
+        vertex.seq = poolView(pool_seq, vertices.data()[i].kmer, k);
+        vertex.rc().seq = !vertex.seq;
+        vertex_list[i] = &vertex;
+    }
+//    Outgoing edges of a vertex and its rc are only added by the task of this vertex, so their order is preserved
+#pragma omp parallel for schedule(dynamic, 1024)
+    for(size_t i = 0; i < vertices.size(); i++) {
+        size_t last_edge = i + 1 < vertices.size() ? vertices.data()[i + 1].first_edge : edges.size();
+        for(size_t j = vertices.data()[i].first_edge; j < last_edge; j++) {
+            const SnapshotEdge &rec = edges.data()[j];
+            Vertex &start = rec.start % 2 == 0 ? *vertex_list[rec.start / 2] : vertex_list[rec.start / 2]->rc();
+            Vertex *end = rec.end == NO_VERTEX ? nullptr :
+                          rec.end % 2 == 0 ? vertex_list[rec.end / 2] : &vertex_list[rec.end / 2]->rc();
+            Sequence full = poolView(pool_seq, rec.seq, k + rec.size);
+            Edge &edge = start.addEdgeLockFree(Edge(&start, end, full.Subseq(k)));
+            edge.incCov(rec.cov);
+        }
+    }
+    logger.info() << "Loaded graph with " << vertices.size() << " vertices and " << edges.size() << " edges" << std::endl;
+    cout << "LoadGraphSnapshot time: " << t.get() << endl;
+    return std::move(dbg);
+}
+
+void dbg::LoadSnapshotReads(logging::Logger &logger, const std::experimental::filesystem::path &dir,
+                            const std::vector<RecordStorage *> &recs, SparseDBG &dbg) {
+    logging::TimeSpace t;
+    const uint64_t tag = snapshotTag(dbg.hasher().getK());
+    MappedArray<SnapshotVertex> vertices(dir / "vertices.bin", tag);
+    MappedArray<uint64_t> storages(dir / "storages.bin", tag);
+    MappedArray<SnapshotPath> paths(dir / "paths.bin", tag);
+    std::shared_ptr<MappedArray<uint64_t>> path_edges =
+            std::make_shared<MappedArray<uint64_t>>(dir / "path_edges.bin", tag);
+    MappedArray<char> names(dir / "names.bin", tag);
+    VERIFY_MSG(vertices.valid() && storages.valid() && paths.valid() && path_edges->valid() && names.valid(),
+               "Read paths of graph snapshot " + dir.string() + " are damaged");
+    VERIFY(storages.size() == recs.size());
+    const Sequence edges_seq = Sequence::View(path_edges->data(), path_edges->size() * 32, path_edges);
+    size_t cur = 0;
+    for(size_t i = 0; i < recs.size(); i++) {
+        RecordStorage &recordStorage = *recs[i];
+//        Coverage saved with the graph already includes these reads
+        bool track_cov = recordStorage.track_cov;
+        recordStorage.track_cov = false;
+        for(size_t j = 0; j < storages.data()[i]; j++, cur++) {
+            const SnapshotPath &rec = paths.data()[cur];
+            std::string name(names.data() + rec.name, rec.name_size);
+            if(rec.start == NO_VERTEX) {
+                recordStorage.addRead(AlignedRead(name));
+                continue;
+            }
+            Vertex &start = dbg.getVertex(vertices.data()[rec.start / 2].hash, rec.start % 2 == 0);
+            recordStorage.addRead(AlignedRead(name, CompactPath(start, edges_seq.Subseq(rec.edges, rec.edges + rec.size),
+                                                                rec.left, rec.right)));
+        }
+        recordStorage.track_cov = track_cov;
+    }
+    logger.info() << "Loaded " << cur << " read paths from graph snapshot" << std::endl;
+    cout << "LoadSnapshotReads time: " << t.get() << endl;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "sparse_dbg.hpp"
+#include "graph_alignment_storage.hpp"
+#include "common/logging.hpp"
+#include "common/rolling_hash.hpp"
+#include <experimental/filesystem>
+#include <vector>
+
+/*
+ * Binary snapshot of a sparse de Bruijn graph together with read paths of record storages. It is a directory of
+ * checksummed binary arrays (see binary_array.hpp):
+ *   sequences.bin   2-bit packed pool with the sequence of every edge pair (start k-mer followed by the edge) and
+ *                   k-mers of vertices without edges,
+ *   vertices.bin    hash, position of the k-mer in the pool and range of outgoing edges of each vertex and its rc,
+ *   edges.bin       start, end, position in the pool, length and coverage of every edge in the order of outgoing edges,
+ *   storages.bin    number of reads in every record storage,
+ *   paths.bin       start vertex, position of edge letters, skips and name of every read path,
+ *   path_edges.bin  2-bit packed first letters of edges of read paths,
+ *   names.bin       read names.
+ * Vertices and edges refer to each other by indices, positions in pools are multiplied by 2 with the lowest bit set for
+ * reverse complement views. Hanging edges that end outside of the graph have end -1. Arrays are tagged with the snapshot version and k, so a snapshot of another graph is
+ * rejected. Edge and vertex sequences and read paths of a loaded graph are views into the mapped pools, so loading does
+ * not copy or rehash sequences. The snapshot is written to a temporary directory that is renamed when complete.
+ */
+namespace dbg {
+    bool IsGraphSnapshot(const std::experimental::filesystem::path &dir, size_t k);
+
+    void SaveGraphSnapshot(logging::Logger &logger, const std::experimental::filesystem::path &dir, SparseDBG &dbg,
+                           const std::vector<RecordStorage *> &recs);
+
+//    Edge coverage is restored from the snapshot
+    SparseDBG LoadGraphSnapshot(logging::Logger &logger, const std::experimental::filesystem::path &dir,
+                                hashing::RollingHash &hasher, size_t threads);
+
+//    Storages must be created for the graph returned by LoadGraphSnapshot. Edge coverage is not changed by the reads.
+    void LoadSnapshotReads(logging::Logger &logger, const std::experimental::filesystem::path &dir,
+                           const std::vector<RecordStorage *> &recs, SparseDBG &dbg);
+}
@@ -0,0 +1,255 @@
+#include "minimizer_density.hpp"
+#include "minimizer_selection.hpp"
+#include "sparse_dbg.hpp"
+#include "common/hash_utils.hpp"
+#include "common/omp_utils.hpp"
+#include "common/rolling_hash.hpp"
+#include "common/simple_computation.hpp"
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <parallel/algorithm>
+#include <sstream>
+
+using namespace hashing;
+
+//Size of the record in a FASTA or FASTQ file with one line of sequence
+static size_t recordSize(const StringContig &contig, bool fastq) {
+    size_t header = contig.id.size() + (contig.comment.empty() ? 0 : contig.comment.size() + 1) + 2;
+    return header + contig.seq.size() + 1 + (fastq ? contig.seq.size() + 3 : 0);
+}
+
+std::vector<Sequence> SampleReads(logging::Logger &logger, const io::Library &lib, double fraction, size_t threads) {
+    logging::TimeSpace t;
+    logger.info() << "Sampling " << fraction * 100 << "% of reads" << std::endl;
+//    Reads are selected by hash of their index, so the sample does not depend on the number of threads
+    const auto threshold = static_cast<uint64_t>(std::min(1.0, fraction) * double(std::numeric_limits<uint64_t>::max()));
+    std::vector<Sequence> res;
+    for(const std::experimental::filesystem::path &file : lib) {
+        if(endsWith(file, io::read_cache_extension)) {
+//            Reads of a read cache are accessed by index, so only the sampled ones are read
+            io::MappedReadStore store(file);
+            for(size_t i = 0; i < store.size(); i++) {
+                if(mix64(i) <= threshold)
+                    res.emplace_back(store.get(i).copy());
+            }
+        } else if(endsWith(file, ".gz")) {
+//            Uncompressed size of a gzip file is not known before it is read, so the whole file is sampled
+            ParallelRecordCollector<Sequence> sample(threads);
+            std::function<void(size_t, StringContig &)> task = [&sample, threshold](size_t pos, StringContig &contig) {
+                if(mix64(pos) <= threshold)
+                    sample.emplace_back(contig.makeSequence());
+            };
+            io::SeqReader reader(file);
+            processRecordsPipelined(reader.begin(), reader.end(), logger, threads, task);
+            std::vector<Sequence> file_sample = sample.collect();
+            res.insert(res.end(), file_sample.begin(), file_sample.end());
+        } else {
+//            Plain files are read only up to the fraction of their size. Reads follow in the order they were sequenced,
+//            so the beginning of a file samples the genome as well as any other part of it.
+            const bool fastq = endsWith(file, "fastq") || endsWith(file, "fq");
+            const double budget = fraction * double(std::experimental::filesystem::file_size(file));
+            std::vector<StringContig> contigs;
+            size_t consumed = 0;
+            io::SeqReader reader(file);
+            while(!reader.eof() && double(consumed) < budget) {
+                contigs.emplace_back(reader.read());
+                consumed += recordSize(contigs.back(), fastq);
+            }
+            size_t start = res.size();
+            res.resize(start + contigs.size());
+#pragma omp parallel for schedule(dynamic, 16) num_threads(threads)
+            for(size_t i = 0; i < contigs.size(); i++)
+                res[start + i] = contigs[i].makeSequence();
+        }
+    }
+    logger.info() << "Sampled " << res.size() << " reads of total length " << total_size(res) << std::endl;
+    cout << "SampleReads(" << fraction << ") time: " << t.get() << endl;
+    return std::move(res);
+}
+
+//Poisson(c) conditioned on value at least 2 has mean c (1 - e^-c) / (1 - e^-c - c e^-c), which grows with c
+static double solidCoverage(double solid_mean) {
+    double left = 1e-6;
+    double right = 1e6;
+    for(size_t iter = 0; iter < 100; iter++) {
+        double c = (left + right) / 2;
+        double mean = c * (1 - std::exp(-c)) / (1 - std::exp(-c) - c * std::exp(-c));
+        if(mean < solid_mean)
+            left = c;
+        else
+            right = c;
+    }
+    return (left + right) / 2;
+}
+
+MinimizerDensityEstimate EstimateMinimizerDensity(const std::vector<Sequence> &sample, double fraction, size_t k,
+                                                  size_t w, bool corrected, size_t threads) {
+    MinimizerDensityEstimate res;
+    res.k = k;
+    res.w = w;
+    res.corrected = corrected;
+    const BasicRollingHash<htype64> hasher = RollingHash(k, 239).narrow<htype64>();
+//    Minimizer orientation is stored in the lowest bit, so that consecutive minimizers of a read give directed edges
+    std::vector<std::vector<uint64_t>> occurrences(threads);
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> links(threads);
+    std::vector<BasicMinimizerEngine<htype64>> engines;
+    for(size_t i = 0; i < threads; i++)
+        engines.emplace_back(hasher, w, MinimizerHashing::scheme, MinimizerHashing::syncmer_length);
+    omp_set_num_threads(threads);
+#pragma omp parallel
+    {
+        const size_t thread = omp_get_thread_num();
+        std::vector<BasicHashedKmer<htype64>> kmers;
+#pragma omp for schedule(dynamic, 16)
+        for(size_t i = 0; i < sample.size(); i++) {
+            if(sample[i].size() < k + w - 1)
+                continue;
+            kmers.clear();
+            engines[thread].minimizers(sample[i], kmers);
+            for(size_t j = 0; j < kmers.size(); j++) {
+                uint64_t node = (kmers[j].hash() << 1u) | uint64_t(!kmers[j].isCanonical());
+                occurrences[thread].push_back(node >> 1u);
+                if(j > 0) {
+                    uint64_t prev = (kmers[j - 1].hash() << 1u) | uint64_t(!kmers[j - 1].isCanonical());
+                    links[thread].emplace_back(prev, node);
+                    links[thread].emplace_back(node ^ 1u, prev ^ 1u);
+                }
+            }
+        }
+    }
+    std::vector<uint64_t> hashes;
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    for(size_t i = 0; i < threads; i++) {
+        hashes.insert(hashes.end(), occurrences[i].begin(), occurrences[i].end());
+        edges.insert(edges.end(), links[i].begin(), links[i].end());
+    }
+    __gnu_parallel::sort(hashes.begin(), hashes.end());
+    __gnu_parallel::sort(edges.begin(), edges.end());
+    size_t singletons = 0;
+    size_t solid = 0;
+    size_t solid_occurrences = 0;
+    for(size_t i = 0; i < hashes.size();) {
+        size_t j = i;
+        while(j < hashes.size() && hashes[j] == hashes[i])
+            j++;
+        if(j - i == 1) {
+            singletons++;
+        } else {
+            solid++;
+            solid_occurrences += j - i;
+        }
+        i = j;
+    }
+//    Minimizers with at least two distinct solid outgoing edges in some orientation branch the graph
+    std::vector<uint64_t> branching;
+    uint64_t last_start = uint64_t(-1);
+    size_t out_degree = 0;
+    for(size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while(j < edges.size() && edges[j] == edges[i])
+            j++;
+        if(j - i >= 2) {
+            if(edges[i].first != last_start) {
+                last_start = edges[i].first;
+                out_degree = 0;
+            }
+            out_degree++;
+            if(out_degree == 2)
+                branching.push_back(last_start >> 1u);
+        }
+        i = j;
+    }
+    std::sort(branching.begin(), branching.end());
+    branching.erase(std::unique(branching.begin(), branching.end()), branching.end());
+    if(solid < MinimizerDensityEstimate::min_solid_minimizers)
+        return res;
+    double c = solidCoverage(double(solid_occurrences) / solid);
+//    With lower sample coverage most genomic minimizers are not seen twice and the correction is unstable
+    if(c < 1)
+        return res;
+    res.reliable = true;
+    double seen_solid = 1 - std::exp(-c) - c * std::exp(-c);
+    double genomic = solid / seen_solid;
+    double full_coverage = c / fraction;
+    res.coverage = full_coverage;
+    res.genome_size = genomic * (w + 1) / 2;
+    double vertices = branching.size() / seen_solid;
+    res.distinct_minimizers = genomic * (1 - std::exp(-full_coverage));
+    if(!corrected) {
+        double error_minimizers = std::max(0.0, singletons - genomic * c * std::exp(-c)) / fraction;
+        double minimizers_per_error = std::min<double>(k, 2.0 * k / (w + 1));
+        res.distinct_minimizers += error_minimizers;
+        vertices += 2 * error_minimizers / minimizers_per_error;
+    }
+    res.vertices = vertices;
+
+//    Memory model of the first stages: minimizer hashes are kept in thread buffers, the collector and the sorted list;
+//    junction selection keeps disjointigs (about twice the genome) and a bloom filter of 32 bits per k+1-mer;
+//    every vertex of the graph stores two Vertex objects with k-mers, a hash map node and about two edges on each side
+//    and edges store about two copies of the genome.
+    const double kmer_bytes = double((k + 31) / 32 * 8);
+    res.minimizer_memory = res.distinct_minimizers * sizeof(htype) * 3;
+    res.junction_memory = 2 * res.genome_size / 4 + 2 * res.genome_size * 4;
+    res.graph_memory = vertices * (2 * (sizeof(dbg::Vertex) + kmer_bytes) + 64 + 4 * sizeof(dbg::Edge)) +
+                       2 * res.genome_size / 4;
+    return res;
+}
+
+static std::vector<size_t> kCandidates(size_t k) {
+    return {(k / 2) | 1u, k, (k * 2) | 1u};
+}
+
+static std::vector<size_t> wCandidates(size_t w) {
+    return {std::max<size_t>(w / 4, 1), std::max<size_t>(w / 2, 1), w, w * 2, w * 4};
+}
+
+static std::string gb(double bytes) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2) << bytes / 1024 / 1024 / 1024 << "Gb";
+    return ss.str();
+}
+
+static void reportPhase(logging::Logger &logger, const std::vector<Sequence> &sample, double fraction,
+                        size_t memory_budget, const std::string &name, const std::string &k_option,
+                        const std::string &w_option, size_t k0, size_t w0, bool corrected, size_t threads) {
+    logger.info() << "Estimates for " << name << ". k, w, distinct minimizers, vertices, memory for minimizers, "
+                                                 "junctions and graph" << std::endl;
+    std::vector<MinimizerDensityEstimate> estimates;
+    for(size_t k : kCandidates(k0)) {
+        for(size_t w : wCandidates(w0)) {
+            MinimizerDensityEstimate est = EstimateMinimizerDensity(sample, fraction, k, w, corrected, threads);
+            if(est.reliable)
+                logger.info() << k << " " << w << " " << size_t(est.distinct_minimizers) << " "
+                              << size_t(est.vertices) << " " << gb(est.minimizer_memory) << " "
+                              << gb(est.junction_memory) << " " << gb(est.graph_memory) << std::endl;
+            else
+                logger.info() << k << " " << w << " not enough sampled reads longer than k + w" << std::endl;
+            estimates.emplace_back(est);
+        }
+    }
+    const MinimizerDensityEstimate &base = estimates[kCandidates(k0).size() / 2 * wCandidates(w0).size() + 2];
+    if(base.reliable)
+        logger.info() << "Estimated coverage " << size_t(base.coverage) << "x, genome size "
+                      << size_t(base.genome_size) << " (homopolymer compressed)" << std::endl;
+    if(memory_budget == 0)
+        return;
+    for(const MinimizerDensityEstimate &est : estimates) {
+        if(est.reliable && est.k >= k0 && est.w >= w0 && est.peakMemory() <= memory_budget) {
+            logger.info() << "Recommended for " << gb(memory_budget) << " of memory: " << k_option << " " << est.k
+                          << " " << w_option << " " << est.w << std::endl;
+            return;
+        }
+    }
+    logger.info() << "None of the values fits in " << gb(memory_budget) << " of memory for " << name << std::endl;
+}
+
+void MinimizerDensityReport(logging::Logger &logger, const io::Library &lib, double fraction, size_t memory_budget,
+                            size_t k, size_t w, size_t K, size_t W, size_t threads) {
+    logging::TimeSpace t;
+    std::vector<Sequence> sample = SampleReads(logger, lib, fraction, threads);
+    reportPhase(logger, sample, fraction, memory_budget, "initial correction", "-k", "-w", k, w, false, threads);
+    reportPhase(logger, sample, fraction, memory_budget, "final correction (reads assumed corrected)", "-K", "-W", K, W,
+                true, threads);
+    cout << "MinimizerDensityReport time: " << t.get() << endl;
+}
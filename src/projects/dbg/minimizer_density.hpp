@@ -0,0 +1,49 @@
+#pragma once
+
+#include "sequences/seqio.hpp"
+#include "sequences/sequence.hpp"
+#include "common/logging.hpp"
+#include <algorithm>
+#include <vector>
+
+/*
+ * Estimates of the sparse de Bruijn graph size for a choice of k and w, computed from a sample of reads before the
+ * assembly is started. Sampled reads have coverage c = fraction * C. Minimizers that occur at least twice in the sample
+ * are genomic, their multiplicities are treated as Poisson(c), which gives c and the number of genomic minimizers.
+ * Minimizers that occur once beyond what Poisson(c) explains come from sequencing errors and are scaled by 1 / fraction.
+ * Vertices are junctions of the graph: minimizers that branch in the graph of consecutive minimizers of reads and
+ * two junctions per sequencing error. Estimates for corrected reads (second phase) ignore sequencing errors.
+ * All numbers are rough and are meant for sizing jobs, not for exact prediction.
+ */
+struct MinimizerDensityEstimate {
+//    Estimates need enough sampled reads longer than k + w - 1
+    static const size_t min_solid_minimizers = 100;
+
+    size_t k = 0;
+    size_t w = 0;
+    bool corrected = false;
+    bool reliable = false;
+    double coverage = 0;
+    double genome_size = 0;
+    double distinct_minimizers = 0;
+    double vertices = 0;
+    double minimizer_memory = 0;
+    double junction_memory = 0;
+    double graph_memory = 0;
+
+    double peakMemory() const {
+        return std::max(minimizer_memory, std::max(junction_memory, graph_memory));
+    }
+};
+
+//Samples fraction of reads of every file of the library. Plain FASTA and FASTQ files are sampled from their beginning
+//and are read only up to the fraction of their size.
+std::vector<Sequence> SampleReads(logging::Logger &logger, const io::Library &lib, double fraction, size_t threads);
+
+MinimizerDensityEstimate EstimateMinimizerDensity(const std::vector<Sequence> &sample, double fraction, size_t k,
+                                                  size_t w, bool corrected, size_t threads);
+
+//Prints estimates for several values of k and w around the ones of both phases and recommends values that fit
+//memory_budget (in bytes, 0 for no recommendation). w is increased before k because larger k resolves fewer repeats.
+void MinimizerDensityReport(logging::Logger &logger, const io::Library &lib, double fraction, size_t memory_budget,
+                            size_t k, size_t w, size_t K, size_t W, size_t threads);
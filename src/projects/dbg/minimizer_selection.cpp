@@ -1,35 +1,96 @@
 #include "minimizer_selection.hpp"
+#include "common/external_sort.hpp"
+#include <memory>
 
 using namespace hashing;
+bool MinimizerHashing::force_narrow = false;
+MinimizerScheme MinimizerHashing::scheme = MinimizerScheme::Standard;
+size_t MinimizerHashing::syncmer_length = 0;
+size_t MinimizerHashing::memory_budget = 0;
+
 std::vector<htype>
 constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size_t threads, const RollingHash &hasher,
-                    const size_t w) {
+                    const size_t w, const std::experimental::filesystem::path &spill_dir) {
     logging::TimeSpace t;
     logger.info() << "Reading reads" << std::endl;
-    std::vector<std::vector<htype>> prev;
-    prev.resize(threads);
-    const size_t buffer_size = 1000000000;
     logger.info() << "Extracting minimizers" << std::endl;
     size_t min_read_size = hasher.getK() + w - 1;
     ParallelRecordCollector<htype> hashs(threads);
-    std::function<void(size_t, StringContig &)> task = [min_read_size, w, &hasher, &hashs](size_t pos, StringContig & contig) {
+    const bool narrow = MinimizerHashing::narrow(hasher.getK(), w);
+    const BasicRollingHash<htype64> narrow_hasher = hasher.narrow<htype64>();
+    if(narrow)
+        logger.info() << "Selecting minimizers with 64-bit hashes" << std::endl;
+    if(MinimizerHashing::scheme != MinimizerScheme::Standard)
+        logger.info() << "Using " << (MinimizerHashing::scheme == MinimizerScheme::Robust ? "robust winnowing" : "syncmers")
+                      << " for minimizer selection" << std::endl;
+//    Engines and minimizer buffers are per thread. Buffers are deduplicated and flushed to the collector when they
+//    grow large, so repeated minimizers of overlapping reads are mostly dropped before they reach the collector.
+    const size_t buffer_size = 1 << 16;
+    std::vector<BasicMinimizerEngine<htype>> engines;
+    std::vector<BasicMinimizerEngine<htype64>> narrow_engines;
+    for(size_t i = 0; i < threads; i++) {
+        if(narrow)
+            narrow_engines.emplace_back(narrow_hasher, w, MinimizerHashing::scheme, MinimizerHashing::syncmer_length);
+        else
+            engines.emplace_back(hasher, w, MinimizerHashing::scheme, MinimizerHashing::syncmer_length);
+    }
+    std::vector<std::vector<BasicHashedKmer<htype>>> kmer_buffers(threads);
+    std::vector<std::vector<BasicHashedKmer<htype64>>> narrow_kmer_buffers(threads);
+    std::vector<std::vector<htype>> buffers(threads);
+    std::unique_ptr<ExternalDistinctCollector<htype, alt_hasher<htype>>> external;
+    if(MinimizerHashing::memory_budget > 0) {
+        std::experimental::filesystem::path dir = spill_dir.empty() ? std::experimental::filesystem::temp_directory_path() : spill_dir;
+        logger.info() << "Collecting minimizers in " << MinimizerHashing::memory_budget / 1024 / 1024
+                      << "Mb of memory, sorted runs are stored in " << dir << std::endl;
+        external.reset(new ExternalDistinctCollector<htype, alt_hasher<htype>>(dir, "minimizers", threads,
+                                                                               MinimizerHashing::memory_budget));
+    }
+    std::function<void(size_t, std::vector<htype> &)> flush = [&hashs, &external](size_t thread, std::vector<htype> &buffer) {
+        if(external) {
+            external->addAll(thread, buffer.begin(), buffer.end());
+        } else {
+            std::sort(buffer.begin(), buffer.end());
+            buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+            hashs.addAll(buffer.begin(), buffer.end());
+        }
+        buffer.clear();
+    };
+    std::function<void(size_t, StringContig &)> task = [&](size_t pos, StringContig & contig) {
         Sequence seq = contig.makeSequence();
-        if(seq.size() >= min_read_size) {
-            MinimizerCalculator calc(seq, hasher, w);
-            std::vector<htype> minimizers(calc.minimizerHashs());
-            if (minimizers.size() > 10) {
-                std::sort(minimizers.begin(), minimizers.end());
-                minimizers.erase(std::unique(minimizers.begin(), minimizers.end()), minimizers.end());
-            }
-            hashs.addAll(minimizers.begin(), minimizers.end());
+        if(seq.size() < min_read_size)
+            return;
+        size_t thread = omp_get_thread_num();
+        std::vector<htype> &buffer = buffers[thread];
+        if(narrow) {
+            std::vector<BasicHashedKmer<htype64>> &kmers = narrow_kmer_buffers[thread];
+            kmers.clear();
+            narrow_engines[thread].minimizers(seq, kmers);
+            for(const BasicHashedKmer<htype64> &kmer : kmers)
+                buffer.push_back(KWH(hasher, seq, kmer.pos).hash());
+        } else {
+            std::vector<BasicHashedKmer<htype>> &kmers = kmer_buffers[thread];
+            kmers.clear();
+            engines[thread].minimizers(seq, kmers);
+            for(const BasicHashedKmer<htype> &kmer : kmers)
+                buffer.push_back(kmer.hash());
         }
+        if(buffer.size() >= buffer_size)
+            flush(thread, buffer);
     };
     io::SeqReader reader(reads_file, (hasher.getK() + w) * 20, (hasher.getK() + w) * 4);
-    processRecords(reader.begin(), reader.end(), logger, threads, task);
+    processRecordsPipelined(reader.begin(), reader.end(), logger, threads, task);
+    for(size_t thread = 0; thread < threads; thread++)
+        flush(thread, buffers[thread]);
 
     logger.info() << "Finished read processing" << std::endl;
-    logger.info() << hashs.size() << " hashs collected. Starting sorting." << std::endl;
-    std::vector<htype> hash_list = hashs.collectUnique();
+    std::vector<htype> hash_list;
+    if(external) {
+        logger.info() << "Merging " << external->runNumber() << " sorted runs of minimizers." << std::endl;
+        hash_list = external->collect();
+    } else {
+        logger.info() << hashs.size() << " hashs collected. Starting sorting." << std::endl;
+        hash_list = hashs.collectUnique();
+    }
     //    TODO replace with parallel std::sort
 //    __gnu_parallel::sort(hash_list.begin(), hash_list.end());
 //    hash_list.erase(std::unique(hash_list.begin(), hash_list.end()), hash_list.end());
@@ -9,7 +9,35 @@
 #include "sequences/seqio.hpp"
 #include "common/logging.hpp"
 #include "common/omp_utils.hpp"
+#include <experimental/filesystem>
+
+//Minimizers can be selected by 64-bit rolling hashes, then only the selected k-mers are hashed with the full hash.
+//Rehashing costs O(k) per minimizer, so by default this is done only if windows are not shorter than k-mers.
+//Scheme and syncmer length (0 for the default one) trade minimizer density for speed of the sparse graph, see
+//hashing::BasicMinimizerEngine.
+//If memory_budget (in bytes) is not 0, distinct minimizers are collected with ExternalDistinctCollector that spills
+//sorted runs to disk instead of keeping all minimizer occurrences in memory.
+struct MinimizerHashing {
+    static bool force_narrow;
+    static hashing::MinimizerScheme scheme;
+    static size_t syncmer_length;
+    static size_t memory_budget;
+
+    static bool narrow(size_t k, size_t w) {
+        return force_narrow || w >= k;
+    }
+
+    static hashing::MinimizerScheme parseScheme(const std::string &name) {
+        if(name == "standard")
+            return hashing::MinimizerScheme::Standard;
+        if(name == "robust")
+            return hashing::MinimizerScheme::Robust;
+        VERIFY_MSG(name == "syncmer", "Unknown minimizer scheme " + name);
+        return hashing::MinimizerScheme::Syncmer;
+    }
+};
 
 std::vector<hashing::htype> constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size_t threads,
-                                       const hashing::RollingHash &hasher, const size_t w);
+                                       const hashing::RollingHash &hasher, const size_t w,
+                                       const std::experimental::filesystem::path &spill_dir = "");
 
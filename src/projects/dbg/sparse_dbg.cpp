@@ -179,8 +179,26 @@ Sequence Edge::firstNucl() const {
 //    return os;
 //}
 
-Vertex::Vertex(hashing::htype hash, Vertex *_rc) : hash_(hash), rc_(_rc), canonical(false) {
-    omp_init_lock(&writelock);
+static omp_lock_t *vertexLocks() {
+    static omp_lock_t *locks = []() {
+        auto *res = new omp_lock_t[size_t(1) << Vertex::lock_bits];
+        for(size_t i = 0; i < (size_t(1) << Vertex::lock_bits); i++)
+            omp_init_lock(&res[i]);
+        return res;
+    }();
+    return locks;
+}
+
+void Vertex::lock() const {
+    omp_set_lock(&vertexLocks()[lockId()]);
+}
+
+bool Vertex::tryLock() const {
+    return omp_test_lock(&vertexLocks()[lockId()]);
+}
+
+void Vertex::unlock() const {
+    omp_unset_lock(&vertexLocks()[lockId()]);
 }
 
 bool Vertex::isCanonical() const {
@@ -202,7 +220,7 @@ bool Vertex::isCanonical(const Edge &edge) const {
 }
 
 void Vertex::checkConsistency() const {
-    for (const Edge &edge : outgoing_) {
+    for (const Edge &edge : *this) {
         if (edge.end() != nullptr) {
             if (edge.rc().end() != &(this->rc())) {
                 std::cout << this << " " << seq << " " << edge.seq << " " << edge.rc().end() << " "
@@ -250,7 +268,7 @@ void Vertex::setSequence(const Sequence &_seq) {
             seq = Sequence(_seq.str());
             unlock();
             rc_->lock();
-            rc_->seq = !_seq;
+            rc_->seq = !seq;
             rc_->unlock();
         } else {
             unlock();
@@ -273,43 +291,44 @@ void Vertex::clearSequence() {
 }
 
 Edge &Vertex::addEdgeLockFree(const Edge &edge) {
-    for (Edge &e : outgoing_) {
+    for (Edge &e : *this) {
         if (edge.size() <= e.size()) {
             if (edge.seq == e.seq.Subseq(0, edge.size())) {
                 return e;
             }
         } else if (edge.seq.Subseq(0, e.size()) == e.seq) {
             e = edge;
+            unshareSequence();
             return e;
         }
     }
-    outgoing_.emplace_back(edge);
-    return outgoing_.back();
+    outgoing_.push_back(arena_->emplace(edge));
+    return (*this)[outgoing_.size() - 1];
 }
 
 void Vertex::addEdge(const Edge &e) {
-    omp_set_lock(&writelock);
+    lock();
     addEdgeLockFree(e);
-    omp_unset_lock(&writelock);
+    unlock();
 }
 
 Edge &Vertex::getOutgoing(unsigned char c) const {
-    for (Edge &edge : outgoing_) {
+    for (Edge &edge : *this) {
         if (edge.seq[0] == c) {
             return edge;
         }
     }
     std::cout << seq << std::endl;
     std::cout << size_t(c) << std::endl;
-    for (const Edge &edge : outgoing_) {
+    for (const Edge &edge : *this) {
         std::cout << edge.seq << std::endl;
     }
     VERIFY(false);
-    return outgoing_[0];
+    return (*this)[0];
 }
 
 bool Vertex::hasOutgoing(unsigned char c) const {
-    for (const Edge &edge : outgoing_) {
+    for (const Edge &edge : *this) {
         if (edge.seq[0] == c) {
             return true;
         }
@@ -326,28 +345,52 @@ bool Vertex::operator>(const Vertex &other) const {
 }
 
 void Vertex::clear() {
-    outgoing_.clear();
-    rc_->outgoing_.clear();
+    if (outDeg() + inDeg() > 0)
+        unshareSequence();
+    clearOutgoing();
+    rc_->clearOutgoing();
+}
+
+void Vertex::unshareSequence() {
+    if (!seq.empty()) {
+        seq = seq.copy();
+        rc_->seq = !seq;
+    }
 }
 
 void Vertex::clearOutgoing() {
+    for(size_t i = 0; i < outgoing_.size(); i++)
+        arena_->release(outgoing_[i]);
     outgoing_.clear();
 }
 
-Vertex::Vertex(hashing::htype hash) : hash_(hash), rc_(new Vertex(hash, this)), canonical(true) {
-    omp_init_lock(&writelock);
+Vertex::Vertex(hashing::htype hash, Vertex *_rc, EdgeArena<Edge> *arena) :
+        arena_(arena), rc_(_rc), hash_(hash), canonical(false) {
+}
+
+Vertex::Vertex(hashing::htype hash) : arena_(new EdgeArena<Edge>()), rc_(new Vertex(hash, this, arena_)), hash_(hash),
+        canonical(true), owns_rc_(true) {
+}
+
+Vertex::Vertex(hashing::htype hash, Vertex &twin, bool canonical, EdgeArena<Edge> &arena) :
+        arena_(&arena), rc_(&twin), hash_(hash), canonical(canonical) {
 }
 
 Vertex::~Vertex() {
-    if (rc_ != nullptr) {
+    clearOutgoing();
+    if (owns_rc_ && rc_ != nullptr) {
         rc_->rc_ = nullptr;
         delete rc_;
+        delete arena_;
     }
     rc_ = nullptr;
 }
 
 void Vertex::sortOutgoing() {
-    std::sort(outgoing_.begin(), outgoing_.end());
+    const EdgeArena<Edge> &arena = *arena_;
+    std::sort(outgoing_.data(), outgoing_.data() + outgoing_.size(), [&arena](EdgeArena<Edge>::id_type a, EdgeArena<Edge>::id_type b) {
+        return arena[a] < arena[b];
+    });
 }
 
 bool Vertex::isJunction() const {
@@ -386,6 +429,73 @@ void SparseDBG::checkSeqFilled(size_t threads, logging::Logger &logger) {
     std::cout << "SparseDBG::checkSeqFilled(size_t " << threads << ", logging::Logger &logger) time: " << t.get() << std::endl;
 }
 
+void SparseDBG::shareSequences(logging::Logger &logger, size_t threads) {
+    logging::TimeSpace t;
+    logger.trace() << "Sharing sequences of vertices and edges" << std::endl;
+    const size_t k = hasher_.getK();
+    ParallelRecordCollector<std::pair<Edge *, Edge *>> long_edges(threads);
+    std::function<void(size_t, std::pair<const hashing::htype, Vertex> &)> collect_task =
+            [&long_edges, k](size_t pos, std::pair<const hashing::htype, Vertex> &pair) {
+                for (Vertex *vertex : {&pair.second, &pair.second.rc()}) {
+                    for (Edge &edge : *vertex) {
+                        if (edge.size() > k && edge.end() != nullptr && edge <= edge.rc())
+                            long_edges.emplace_back(&edge, &edge.rc());
+                    }
+                }
+            };
+    processObjects(v.begin(), v.end(), logger, threads, collect_task);
+    std::vector<std::pair<Edge *, Edge *>> edge_list = long_edges.collect();
+    omp_set_num_threads(threads);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < edge_list.size(); i++) {
+        Edge &edge = *edge_list[i].first;
+        Sequence full = Sequence((edge.start()->seq + edge.seq).str());
+        edge.seq = full.Subseq(k);
+        edge_list[i].second->seq = (!full).Subseq(k);
+    }
+//    Vertex k-mers are taken as suffixes of the new edge buffers only after all buffers are built since the loop above
+//    reads start k-mers. First edge to claim a canonical vertex provides its k-mer. Marks are cleared in share_task.
+    size_t shared = 0;
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:shared)
+    for (size_t i = 0; i < edge_list.size(); i++) {
+        for (Edge *edge : {edge_list[i].first, edge_list[i].second}) {
+            Vertex *vertex = edge->end()->isCanonical() ? edge->end() : &edge->end()->rc();
+            if (__atomic_exchange_n(&vertex->mark_, true, __ATOMIC_ACQ_REL))
+                continue;
+            Sequence kmer = edge->seq.Suffix(k);
+            vertex->seq = vertex == edge->end() ? kmer : !kmer;
+            vertex->rc().seq = !vertex->seq;
+            shared++;
+        }
+    }
+    size_t short_edges = 0;
+    std::function<void(size_t, std::pair<const hashing::htype, Vertex> &)> share_task =
+            [](size_t pos, std::pair<const hashing::htype, Vertex> &pair) {
+                Vertex &cvertex = pair.second;
+                if (cvertex.marked())
+                    cvertex.unmark();
+                else
+                    cvertex.rc().seq = !cvertex.seq;
+            };
+    processObjects(v.begin(), v.end(), logger, threads, share_task);
+    std::function<void(size_t, std::pair<const hashing::htype, Vertex> &)> short_task =
+            [&short_edges, k](size_t pos, std::pair<const hashing::htype, Vertex> &pair) {
+                for (Vertex *vertex : {&pair.second, &pair.second.rc()}) {
+                    for (Edge &edge : *vertex) {
+                        if (edge.size() <= k && edge.end() != nullptr) {
+                            edge.seq = edge.end()->seq.Subseq(k - edge.size());
+#pragma omp atomic
+                            short_edges++;
+                        }
+                    }
+                }
+            };
+    processObjects(v.begin(), v.end(), logger, threads, short_task);
+    logger.trace() << "Shared buffers of " << edge_list.size() << " long edge pairs with " << shared
+                   << " vertices. " << short_edges << " short edges are now views of vertex k-mers" << std::endl;
+    std::cout << "SparseDBG::shareSequences(logging::Logger &logger, size_t " << threads << ") time: " << t.get() << std::endl;
+}
+
 SparseDBG SparseDBG::Subgraph(std::vector<Segment<Edge>> &pieces) {
     SparseDBG res(hasher_);
     for(auto &it : v) {
@@ -670,16 +780,37 @@ EdgePosition SparseDBG::getAnchor(const hashing::KWH &kwh) {
         return anchors.find(kwh.hash())->second.RC();
 }
 
+void SparseDBG::containsVertexBatch(const hashing::htype *hashes, size_t n, unsigned char *res) const {
+    const size_t group = 16;
+    for (size_t start = 0; start < n; start += group) {
+        const size_t end = std::min(n, start + group);
+        for (size_t i = start; i < end; i++) {
+            v.prefetch(hashes[i]);
+        }
+        for (size_t i = start; i < end; i++) {
+            res[i] = containsVertex(hashes[i]);
+        }
+    }
+}
+
 std::vector<hashing::KWH> SparseDBG::extractVertexPositions(const Sequence &seq, size_t max) const {
     std::vector<hashing::KWH> res;
-    hashing::KWH kwh(hasher(), seq, 0);
-    while (true) {
-        if (containsVertex(kwh.hash())) {
-            res.emplace_back(kwh);
+    hashing::BasicKmerScanner<hashing::htype> scanner(hasher(), seq);
+    std::vector<hashing::BasicHashedKmer<hashing::htype>> kmers;
+    std::vector<hashing::htype> hashes;
+    std::vector<unsigned char> found;
+    while (res.size() < max && scanner.nextBlock(kmers)) {
+        hashes.resize(kmers.size());
+        found.resize(kmers.size());
+        for (size_t i = 0; i < kmers.size(); i++) {
+            hashes[i] = kmers[i].hash();
+        }
+        containsVertexBatch(hashes.data(), hashes.size(), found.data());
+        for (size_t i = 0; i < kmers.size() && res.size() < max; i++) {
+            if (found[i]) {
+                res.emplace_back(hasher(), seq, kmers[i]);
+            }
         }
-        if (!kwh.hasNext() || res.size() == max)
-            break;
-        kwh = kwh.next();
     }
     return std::move(res);
 }
@@ -820,8 +951,6 @@ IterableStorage<ApplyingIterator<SparseDBG::vertex_iterator_type, Edge, 8>> Spar
 }
 
 void SparseDBG::removeIsolated() {
-    vertex_map_type newv;
-    std::vector<hashing::htype> todelete;
     for (auto it = v.begin(); it != v.end();) {
         if (it->second.outDeg() == 0 && it->second.inDeg() == 0) {
             it = v.erase(it);
@@ -9,8 +9,11 @@
 #include "common/logging.hpp"
 #include "common/rolling_hash.hpp"
 #include "common/hash_utils.hpp"
+#include "vertex_table.hpp"
+#include "edge_arena.hpp"
 #include <common/oneline_utils.hpp>
 #include <common/iterator_utils.hpp>
+#include <memory>
 #include <vector>
 #include <numeric>
 #include <unordered_map>
@@ -30,7 +33,6 @@ namespace dbg {
     public:
         mutable size_t extraInfo;
         Sequence seq;
-        std::string id = "";
         friend class Vertex;
         bool is_reliable = false;
         Edge(Vertex *_start, Vertex *_end, const Sequence &_seq) :
@@ -65,23 +67,62 @@ namespace dbg {
 
 //    std::ostream& operator<<(std::ostream& os, const Edge& edge);
 
+//    Edges of a graph are stored in the arena of the graph. Vertices refer to their outgoing edges by ids in the arena.
+    class OutgoingIterator {
+    private:
+        const EdgeArena<Edge> *arena;
+        const EdgeArena<Edge>::id_type *pos;
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef Edge value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Edge *pointer;
+        typedef Edge &reference;
+
+        OutgoingIterator(const EdgeArena<Edge> *arena, const EdgeArena<Edge>::id_type *pos) : arena(arena), pos(pos) {}
+        Edge &operator*() const {return (*arena)[*pos];}
+        Edge *operator->() const {return &(*arena)[*pos];}
+        Edge &operator[](difference_type n) const {return (*arena)[pos[n]];}
+        OutgoingIterator &operator++() {++pos; return *this;}
+        OutgoingIterator operator++(int) {OutgoingIterator res = *this; ++pos; return res;}
+        OutgoingIterator &operator--() {--pos; return *this;}
+        OutgoingIterator operator--(int) {OutgoingIterator res = *this; --pos; return res;}
+        OutgoingIterator &operator+=(difference_type n) {pos += n; return *this;}
+        OutgoingIterator &operator-=(difference_type n) {pos -= n; return *this;}
+        OutgoingIterator operator+(difference_type n) const {return {arena, pos + n};}
+        OutgoingIterator operator-(difference_type n) const {return {arena, pos - n};}
+        friend OutgoingIterator operator+(difference_type n, const OutgoingIterator &it) {return it + n;}
+        difference_type operator-(const OutgoingIterator &other) const {return pos - other.pos;}
+        bool operator==(const OutgoingIterator &other) const {return pos == other.pos;}
+        bool operator!=(const OutgoingIterator &other) const {return pos != other.pos;}
+        bool operator<(const OutgoingIterator &other) const {return pos < other.pos;}
+        bool operator>(const OutgoingIterator &other) const {return pos > other.pos;}
+        bool operator<=(const OutgoingIterator &other) const {return pos <= other.pos;}
+        bool operator>=(const OutgoingIterator &other) const {return pos >= other.pos;}
+    };
+
 
 
     class Vertex {
     private:
         friend class SparseDBG;
-        mutable std::vector<Edge> outgoing_{};
+        EdgeIdList outgoing_;
+        EdgeArena<Edge> *arena_;
         Vertex *rc_;
         hashing::htype hash_;
-        omp_lock_t writelock = {};
         size_t coverage_ = 0;
         bool canonical = false;
         bool mark_ = false;
-        explicit Vertex(hashing::htype hash, Vertex *_rc);
+        bool owns_rc_ = false;
+        Vertex(hashing::htype hash, Vertex *_rc, EdgeArena<Edge> *arena);
     public:
         Sequence seq;
 
+//        Standalone vertex that owns its rc and an arena for their edges
         explicit Vertex(hashing::htype hash = 0);
+//        Vertex with rc twin that is stored separately, e.g. next to it in VertexTable. Neither of them owns the other.
+//        Outgoing edges are stored in the arena of the graph that contains the vertex.
+        Vertex(hashing::htype hash, Vertex &twin, bool canonical, EdgeArena<Edge> &arena);
         Vertex(const Vertex &) = delete;
         ~Vertex();
 
@@ -92,13 +133,20 @@ namespace dbg {
         Vertex &rc() {return *rc_;}
         const Vertex &rc() const {return *rc_;}
         void setSequence(const Sequence &_seq);
-        void lock() {omp_set_lock(&writelock);}
-        void unlock() {omp_unset_lock(&writelock);}
-        std::vector<Edge>::iterator begin() const {return outgoing_.begin();}
-        std::vector<Edge>::iterator end() const {return outgoing_.end();}
+//        Vertices are guarded by a shared table of locks chosen by a mix of the low 64 bits of vertex hash. A vertex and
+//        its rc share a lock. Locks are not ordered like vertices, so a thread that holds a lock may take a lock of
+//        another vertex only with tryLock and only if they are not shared.
+        static const size_t lock_bits = 16;
+        size_t lockId() const {return size_t(hashing::mix64(uint64_t(hash_)) >> (64 - lock_bits));}
+        bool sharesLock(const Vertex &other) const {return lockId() == other.lockId();}
+        void lock() const;
+        bool tryLock() const;
+        void unlock() const;
+        OutgoingIterator begin() const {return {arena_, outgoing_.data()};}
+        OutgoingIterator end() const {return {arena_, outgoing_.data() + outgoing_.size()};}
         size_t outDeg() const {return outgoing_.size();}
         size_t inDeg() const {return rc_->outgoing_.size();}
-        Edge &operator[](size_t ind) const {return outgoing_[ind];}
+        Edge &operator[](size_t ind) const {return (*arena_)[outgoing_[ind]];}
 
 
         size_t coverage() const;
@@ -106,6 +154,9 @@ namespace dbg {
         bool isCanonical(const Edge &edge) const;
         void clear();
         void clearOutgoing();
+//        After shareSequences k-mer of a vertex may be a view into the buffer of one of its edges. It is copied when
+//        such an edge is removed or replaced so that the buffer is released together with the edge.
+        void unshareSequence();
         void sortOutgoing();
         void checkConsistency() const;
         std::string getId() const;
@@ -142,19 +193,19 @@ namespace dbg {
 
     class SparseDBG {
     public:
-        typedef std::unordered_map<hashing::htype , Vertex, hashing::alt_hasher<hashing::htype>> vertex_map_type;
-        typedef std::unordered_map<hashing::htype, Vertex, hashing::alt_hasher<hashing::htype>>::iterator vertex_iterator_type;
+        typedef VertexTable<Vertex> vertex_map_type;
+        typedef VertexTable<Vertex>::iterator vertex_iterator_type;
         typedef std::unordered_map<hashing::htype, EdgePosition, hashing::alt_hasher<hashing::htype>> anchor_map_type;
     private:
-//    TODO: replace with perfect hash map? It is parallel, maybe faster and compact.
+//        Declared before vertices, so that vertices release their edges before the arena is destroyed
+        std::unique_ptr<EdgeArena<Edge>> arena_{new EdgeArena<Edge>()};
         vertex_map_type v;
         anchor_map_type anchors;
         hashing::RollingHash hasher_;
 
 //    Be careful since hash does not define vertex. Rc vertices share the same hash
         Vertex &innerAddVertex(hashing::htype h) {
-            return v.emplace(std::piecewise_construct, std::forward_as_tuple(h),
-                             std::forward_as_tuple(h)).first->second;
+            return v.emplace(h, *arena_).first->second;
         }
 
     public:
@@ -168,9 +219,20 @@ namespace dbg {
                 ++begin;
             }
         }
+//        Vertices are created from the list of junction hashes in parallel
+        SparseDBG(const std::vector<hashing::htype> &hashes, hashing::RollingHash _hasher, size_t threads) : hasher_(_hasher) {
+            v.build(hashes.begin(), hashes.end(), threads, *arena_);
+        }
         explicit SparseDBG(hashing::RollingHash _hasher) : hasher_(_hasher) {}
         SparseDBG(SparseDBG &&other) = default;
-        SparseDBG &operator=(SparseDBG &&other) = default;
+//        Old vertices are destroyed before the arena with their edges is replaced
+        SparseDBG &operator=(SparseDBG &&other) {
+            v = std::move(other.v);
+            anchors = std::move(other.anchors);
+            hasher_ = std::move(other.hasher_);
+            arena_ = std::move(other.arena_);
+            return *this;
+        }
         SparseDBG(const SparseDBG &other) noexcept = delete;
 
         SparseDBG Subgraph(std::vector<Segment<Edge>> &pieces);
@@ -179,6 +241,11 @@ namespace dbg {
 
         const hashing::RollingHash &hasher() const {return hasher_;}
         bool containsVertex(const hashing::htype &hash) const {return v.find(hash) != v.end();}
+        size_t vertexTableMemory() const {return v.memory();}
+        size_t edgeArenaMemory() const {return arena_->memory();}
+//        Sets res[i] to 1 if there is a vertex with hash hashes[i]. Index cells of a group of hashes are prefetched
+//        before any lookup, so cache misses of different queries overlap.
+        void containsVertexBatch(const hashing::htype *hashes, size_t n, unsigned char *res) const;
         Vertex &getVertex(const hashing::KWH &kwh);
         Vertex &getVertex(const Sequence &seq);
         Vertex &getVertex(hashing::htype hash, bool canonical = true) {return canonical ? v.find(hash)->second : v.find(hash)->second.rc();}
@@ -192,6 +259,11 @@ namespace dbg {
         void checkConsistency(size_t threads, logging::Logger &logger);
         void checkDBGConsistency(size_t threads, logging::Logger &logger);
         void checkSeqFilled(size_t threads, logging::Logger &logger);
+//        Replaces separate copies of vertex k-mers and edge sequences with views into shared buffers. Edges longer
+//        than k share one buffer with their rc edge, which also holds k-mers of their ends. Shorter edges become views
+//        into the k-mer of their end vertex. Vertex k-mers and their rc share a buffer. Graph must not be modified
+//        concurrently.
+        void shareSequences(logging::Logger &logger, size_t threads);
         void fillAnchors(size_t w, logging::Logger &logger, size_t threads);
         void fillAnchors(size_t w, logging::Logger &logger, size_t threads, const std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> &to_add);
         void processRead(const Sequence &seq);
@@ -0,0 +1,344 @@
+#pragma once
+
+#include "common/hash_utils.hpp"
+#include "common/omp_utils.hpp"
+#include "common/verify.hpp"
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dbg {
+    /*
+     * Hash table of vertices of SparseDBG with the interface of the unordered_map it replaces. Every vertex is stored
+     * together with its rc twin in one slot of a block arena, so vertices are not moved by insertions and erasures and
+     * do not need separate allocations. Slots are found through an open addressing index with linear probing that
+     * stores the key next to the slot number, so a lookup usually reads one cache line of the index.
+     * build inserts a list of hashes from many threads at once: index cells are claimed with CAS and published with
+     * a release store, so find is lock-free and can run concurrently with build. Other modifications (emplace, erase)
+     * must not run concurrently with anything else, as with unordered_map.
+     * V must be constructible as V(hash, twin, canonical, args...) with the twin vertex passed by reference, where args
+     * are the extra arguments of emplace and build.
+     */
+    template<class V>
+    class VertexTable {
+    public:
+        typedef hashing::htype key_type;
+        typedef V mapped_type;
+        typedef std::pair<const key_type, V> value_type;
+
+    private:
+        static const size_t block_bits = 12;
+        static const size_t block_size = size_t(1) << block_bits;
+        static const uint64_t EMPTY = 0;
+        static const uint64_t BUSY = 1;
+        static const uint64_t ERASED = 2;
+        static const uint64_t FIRST_SLOT = 3;
+
+        struct Slot {
+            typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type entry;
+            typename std::aligned_storage<sizeof(V), alignof(V)>::type rc;
+            bool alive;
+
+            value_type &value() {return *reinterpret_cast<value_type *>(&entry);}
+            V &twin() {return *reinterpret_cast<V *>(&rc);}
+        };
+
+//        state is EMPTY, BUSY while the cell is being written, ERASED or FIRST_SLOT + slot number
+        struct Cell {
+            key_type key;
+            std::atomic<uint64_t> state;
+        };
+
+        std::vector<std::unique_ptr<Slot[]>> blocks;
+        std::atomic<size_t> used_slots{0};
+        std::vector<size_t> free_slots;
+        std::unique_ptr<Cell[]> index;
+        size_t mask = 0;
+        size_t occupied_cells = 0;
+        size_t size_ = 0;
+
+        static size_t start(key_type key) {
+            return hashing::mix64(uint64_t(key) ^ hashing::mix64(uint64_t(key >> 64u)));
+        }
+
+        Slot &slot(size_t n) const {
+            return blocks[n >> block_bits][n & (block_size - 1)];
+        }
+
+        void reserveSlots(size_t n) {
+            while(blocks.size() * block_size < n)
+                blocks.emplace_back(new Slot[block_size]());
+        }
+
+        template<class... Args>
+        void construct(size_t n, key_type key, Args &... args) {
+            Slot &s = slot(n);
+            new(&s.entry) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                                     std::forward_as_tuple(key, s.twin(), true, args...));
+            new(&s.rc) V(key, s.value().second, false, args...);
+            s.alive = true;
+        }
+
+        void destroy(size_t n) {
+            Slot &s = slot(n);
+            s.twin().~V();
+            s.value().~value_type();
+            s.alive = false;
+        }
+
+//        Returns index cell with the key or the empty cell where probing stopped. Waits for cells that are being written.
+        size_t probe(key_type key) const {
+            size_t pos = start(key) & mask;
+            while(true) {
+                uint64_t state = index[pos].state.load(std::memory_order_acquire);
+                while(state == BUSY)
+                    state = index[pos].state.load(std::memory_order_acquire);
+                if(state == EMPTY || (state != ERASED && index[pos].key == key))
+                    return pos;
+                pos = (pos + 1) & mask;
+            }
+        }
+
+//        Inserts the key into slot n of the arena if it is absent from the index. Safe to call from many threads at once
+//        for different slots if the index and the arena were resized in advance. Returns whether the key was inserted.
+        template<class... Args>
+        bool insertConcurrent(key_type key, size_t n, Args &... args) {
+            size_t pos = start(key) & mask;
+            while(true) {
+                Cell &cell = index[pos];
+                uint64_t state = cell.state.load(std::memory_order_acquire);
+                if(state == EMPTY) {
+                    if(!cell.state.compare_exchange_strong(state, BUSY, std::memory_order_acq_rel))
+                        continue;
+                    cell.key = key;
+                    construct(n, key, args...);
+                    cell.state.store(FIRST_SLOT + n, std::memory_order_release);
+                    return true;
+                }
+                if(state == BUSY)
+                    continue;
+                if(state != ERASED && cell.key == key)
+                    return false;
+                pos = (pos + 1) & mask;
+            }
+        }
+
+//        Index is kept at most half full, erased cells count as full until the next rehash
+        void rehash(size_t expected_size) {
+            size_t capacity = 16;
+            while(capacity < expected_size * 2)
+                capacity *= 2;
+            index.reset(new Cell[capacity]);
+            for(size_t i = 0; i < capacity; i++)
+                index[i].state.store(EMPTY, std::memory_order_relaxed);
+            mask = capacity - 1;
+            occupied_cells = 0;
+            for(size_t n = 0; n < used_slots; n++) {
+                Slot &s = slot(n);
+                if(!s.alive)
+                    continue;
+                size_t pos = probe(s.value().first);
+                index[pos].key = s.value().first;
+                index[pos].state.store(FIRST_SLOT + n, std::memory_order_relaxed);
+                occupied_cells++;
+            }
+        }
+
+    public:
+        template<bool CONST>
+        class Iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef typename VertexTable::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<CONST, const value_type *, value_type *>::type pointer;
+            typedef typename std::conditional<CONST, const value_type &, value_type &>::type reference;
+        private:
+            friend class VertexTable;
+            const VertexTable *table;
+            size_t n;
+
+            void seek() {
+                while(n < table->used_slots && !table->slot(n).alive)
+                    n++;
+            }
+        public:
+            Iterator(const VertexTable *_table, size_t _n) : table(_table), n(_n) {
+            }
+
+            operator Iterator<true>() const {
+                return {table, n};
+            }
+
+            reference operator*() const {return table->slot(n).value();}
+            pointer operator->() const {return &table->slot(n).value();}
+
+            Iterator &operator++() {
+                n++;
+                seek();
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                Iterator res = *this;
+                ++*this;
+                return res;
+            }
+
+            bool operator==(const Iterator &other) const {return n == other.n;}
+            bool operator!=(const Iterator &other) const {return n != other.n;}
+        };
+
+        typedef Iterator<false> iterator;
+        typedef Iterator<true> const_iterator;
+
+        VertexTable() {
+            rehash(0);
+        }
+
+        VertexTable(VertexTable &&other) noexcept {
+            *this = std::move(other);
+        }
+
+        VertexTable &operator=(VertexTable &&other) noexcept {
+            clear();
+            blocks = std::move(other.blocks);
+            used_slots = other.used_slots.load();
+            free_slots = std::move(other.free_slots);
+            index = std::move(other.index);
+            mask = other.mask;
+            occupied_cells = other.occupied_cells;
+            size_ = other.size_;
+            other.used_slots = 0;
+            other.size_ = 0;
+            other.rehash(0);
+            return *this;
+        }
+
+        VertexTable(const VertexTable &) = delete;
+
+        ~VertexTable() {
+            clear();
+        }
+
+        void clear() {
+            for(size_t n = 0; n < used_slots; n++) {
+                if(slot(n).alive)
+                    destroy(n);
+            }
+            blocks.clear();
+            free_slots.clear();
+            used_slots = 0;
+            size_ = 0;
+            rehash(0);
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        iterator begin() {
+            iterator res(this, 0);
+            res.seek();
+            return res;
+        }
+
+        iterator end() {
+            return {this, used_slots};
+        }
+
+        const_iterator begin() const {
+            const_iterator res(this, 0);
+            res.seek();
+            return res;
+        }
+
+        const_iterator end() const {
+            return {this, used_slots};
+        }
+
+        iterator find(key_type key) {
+            size_t pos = probe(key);
+            uint64_t state = index[pos].state.load(std::memory_order_acquire);
+            return state == EMPTY ? end() : iterator(this, state - FIRST_SLOT);
+        }
+
+        const_iterator find(key_type key) const {
+            size_t pos = probe(key);
+            uint64_t state = index[pos].state.load(std::memory_order_acquire);
+            return state == EMPTY ? end() : const_iterator(this, state - FIRST_SLOT);
+        }
+
+        void prefetch(key_type key) const {
+            __builtin_prefetch(&index[start(key) & mask]);
+        }
+
+        template<class... Args>
+        std::pair<iterator, bool> emplace(key_type key, Args &... args) {
+            if((occupied_cells + 1) * 2 > mask + 1)
+                rehash(size_ * 2 + 1);
+            size_t pos = probe(key);
+            uint64_t state = index[pos].state.load(std::memory_order_relaxed);
+            if(state != EMPTY)
+                return {iterator(this, state - FIRST_SLOT), false};
+            size_t n;
+            if(free_slots.empty()) {
+                n = used_slots++;
+                reserveSlots(used_slots);
+            } else {
+                n = free_slots.back();
+                free_slots.pop_back();
+            }
+            construct(n, key, args...);
+            index[pos].key = key;
+            index[pos].state.store(FIRST_SLOT + n, std::memory_order_release);
+            occupied_cells++;
+            size_++;
+            return {iterator(this, n), true};
+        }
+
+//        Inserts hashes from a random access range in parallel. Repeated hashes are inserted once. Vertices are placed
+//        in the arena in the order of the range, so iteration order does not depend on scheduling of threads.
+        template<class I, class... Args>
+        void build(I begin, I end, size_t threads, Args &... args) {
+            const size_t n = end - begin;
+            const size_t first = used_slots;
+            rehash(size_ + n);
+            reserveSlots(first + n);
+            size_t inserted = 0;
+            omp_set_num_threads(threads);
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:inserted)
+            for(size_t i = 0; i < n; i++) {
+                slot(first + i).alive = false;
+                inserted += insertConcurrent(*(begin + i), first + i, args...);
+            }
+            used_slots = first + n;
+            for(size_t i = 0; i < n; i++) {
+                if(!slot(first + i).alive)
+                    free_slots.push_back(first + i);
+            }
+            size_ += inserted;
+            occupied_cells += inserted;
+        }
+
+        iterator erase(iterator it) {
+            size_t n = it.n;
+            size_t pos = probe(it->first);
+            index[pos].state.store(ERASED, std::memory_order_release);
+            destroy(n);
+            free_slots.push_back(n);
+            size_--;
+            return ++it;
+        }
+
+        size_t memory() const {
+            return blocks.size() * block_size * sizeof(Slot) + (mask + 1) * sizeof(Cell);
+        }
+    };
+}
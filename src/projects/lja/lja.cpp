@@ -10,7 +10,10 @@
 #include "repeat_resolution/repeat_resolution.hpp"
 #include "error_correction/precorrection.hpp"
 #include "sequences/seqio.hpp"
+#include "sequences/read_cache_writer.hpp"
 #include "dbg/dbg_construction.hpp"
+#include "dbg/graph_snapshot.hpp"
+#include "dbg/minimizer_density.hpp"
 #include "common/rolling_hash.hpp"
 #include "common/dir_utils.hpp"
 #include "common/cl_parser.hpp"
@@ -70,6 +73,12 @@ void PrintPaths(logging::Logger &logger, const std::experimental::filesystem::pa
     cout << "PrintPath time: " << t.get() << endl;
 }
 
+//Vertices are selected again if the previous run stopped before they were saved
+static std::string SavedVertices(const std::experimental::filesystem::path &dir) {
+    std::experimental::filesystem::path vertices = dir / "vertices.save";
+    return std::experimental::filesystem::exists(vertices) ? vertices.string() : "none";
+}
+
 std::pair<std::experimental::filesystem::path, std::experimental::filesystem::path>
 AlternativeCorrection(logging::Logger &logger, const std::experimental::filesystem::path &dir,
             const io::Library &reads_lib, const io::Library &pseudo_reads_lib, const io::Library &paths_lib,
@@ -86,7 +95,7 @@ bool close_gaps, bool remove_bad, bool skip, bool debug, bool load) {
     std::function<void()> ic_task = [&dir, &logger, &hasher, close_gaps, load, remove_bad, k, w, &reads_lib,
             &pseudo_reads_lib, &paths_lib, threads, threshold, reliable_coverage, debug] {
         io::Library construction_lib = reads_lib + pseudo_reads_lib;
-        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), (dir/"vertices.save").string()) :
+        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), SavedVertices(dir)) :
                         DBGPipeline(logger, hasher, w, reads_lib, dir, threads);
         dbg.fillAnchors(w, logger, threads);
         size_t extension_size = std::max<size_t>(k * 2, 1000);
@@ -149,7 +158,7 @@ std::vector<std::experimental::filesystem::path> NoCorrection(logging::Logger &l
     std::function<void()> ic_task = [&dir, &logger, &hasher, load, k, w, &reads_lib,
             &pseudo_reads_lib, &paths_lib, threads, debug] {
         io::Library construction_lib = reads_lib + pseudo_reads_lib;
-        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), (dir/"vertices.save").string()) :
+        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), SavedVertices(dir)) :
                         DBGPipeline(logger, hasher, w, reads_lib, dir, threads);
         dbg.fillAnchors(w, logger, threads);
         size_t extension_size = std::max<size_t>(k * 2, 1000);
@@ -166,13 +175,14 @@ std::vector<std::experimental::filesystem::path> NoCorrection(logging::Logger &l
         printDot(dir / "final_dbg.dot", Component(dbg), readStorage.labeler());
         printGFA(dir / "final_dbg.gfa", Component(dbg), true);
         SaveAllReads(dir/"final_dbg.aln", {&readStorage, &extra_reads});
+        SaveGraphSnapshot(logger, dir / "final_dbg.snapshot", dbg, {&readStorage, &extra_reads});
         readStorage.printReadFasta(logger, dir / "corrected_reads.fasta");
     };
     if(!skip)
         runInFork(ic_task);
     cout << "NoCorrection time: " << t.get() << endl;
 
-    return {dir/"corrected_reads.fasta", dir / "final_dbg.fasta", dir / "final_dbg.aln"};
+    return {dir/"corrected_reads.fasta", dir / "final_dbg.fasta", dir / "final_dbg.snapshot"};
   
 }
 
@@ -199,7 +209,7 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
         SparseDBG dbg =
             load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads,
                                (dir/"disjointigs.fasta").string(),
-                               (dir/"vertices.save").string())
+                               SavedVertices(dir))
                  : DBGPipeline(logger, hasher, w, reads_lib, dir, threads);
         dbg.fillAnchors(w, logger, threads);
         size_t extension_size = 10000000;
@@ -241,6 +251,7 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
         printDot(dir / "final_dbg.dot", Component(dbg), readStorage.labeler());
         printGFA(dir / "final_dbg.gfa", Component(dbg), true);
         SaveAllReads(dir/"final_dbg.aln", {&readStorage, &extra_reads});
+        SaveGraphSnapshot(logger, dir / "final_dbg.snapshot", dbg, {&readStorage, &extra_reads});
         readStorage.printReadFasta(logger, dir / "corrected_reads.fasta");
     };
     if(!skip)
@@ -250,24 +261,30 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
     logger.info() << "Second phase results with k = " << k << " printed to "
                   << res << std::endl;
     cout << "SecondPhase time: " << t.get() << endl;
-    return {res, dir / "final_dbg.fasta", dir / "final_dbg.aln"};
+    return {res, dir / "final_dbg.fasta", dir / "final_dbg.snapshot"};
 }
 
 std::vector<std::experimental::filesystem::path> MDBGPhase(
         logging::Logger &logger, size_t threads, size_t k, size_t kmdbg, size_t w, size_t unique_threshold, bool diploid,
         const std::experimental::filesystem::path &dir,
         const std::experimental::filesystem::path &graph_fasta,
-        const std::experimental::filesystem::path &read_paths, bool skip, bool debug) {
+        const std::experimental::filesystem::path &snapshot, bool skip, bool debug) {
     logging::TimeSpace t;
     logger.info() << "Performing repeat resolution by transforming de Bruijn graph into Multiplex de Bruijn graph" << std::endl;
-    std::function<void()> ic_task = [&logger, threads, debug, k, kmdbg, &graph_fasta, unique_threshold, diploid, &read_paths, &dir] {
+    std::function<void()> ic_task = [&logger, threads, debug, k, kmdbg, &graph_fasta, unique_threshold, diploid, &snapshot, &dir] {
         hashing::RollingHash hasher(k, 239);
-        SparseDBG dbg = dbg::LoadDBGFromFasta({graph_fasta}, hasher, logger, threads);
+//        Output directories of older versions only have the graph in fasta and read paths in text format
+        bool use_snapshot = dbg::IsGraphSnapshot(snapshot, k);
+        SparseDBG dbg = use_snapshot ? dbg::LoadGraphSnapshot(logger, snapshot, hasher, threads) :
+                        dbg::LoadDBGFromFasta({graph_fasta}, hasher, logger, threads);
         size_t extension_size = 10000000;
         ReadLogger readLogger(threads, dir/"read_log.txt");
         RecordStorage readStorage(dbg, 0, extension_size, threads, readLogger, true, debug);
         RecordStorage extra_reads(dbg, 0, extension_size, threads, readLogger, false, debug);
-        LoadAllReads(read_paths, {&readStorage, &extra_reads}, dbg);
+        if(use_snapshot)
+            dbg::LoadSnapshotReads(logger, snapshot, {&readStorage, &extra_reads}, dbg);
+        else
+            LoadAllReads(snapshot.parent_path() / "final_dbg.aln", {&readStorage, &extra_reads}, dbg);
         repeat_resolution::RepeatResolver rr(dbg, &readStorage, {&extra_reads},
                                              k, kmdbg, dir, unique_threshold,
                                              diploid, debug, logger);
@@ -284,17 +301,17 @@ std::vector<std::experimental::filesystem::path> PolishingPhase(
         const std::experimental::filesystem::path &output_dir,
         const std::experimental::filesystem::path &gfa_file,
         const std::experimental::filesystem::path &corrected_reads,
-        const io::Library &reads, size_t dicompress, size_t min_alignment, bool skip, bool debug) {
+        const io::Library &reads, io::ReadFilter *filter, size_t dicompress, size_t min_alignment, bool skip, bool debug) {
     logging::TimeSpace t;
     logger.info() << "Performing polishing and homopolymer uncompression" << std::endl;
-    std::function<void()> ic_task = [&logger, threads, &output_dir, debug, &gfa_file, &corrected_reads, &reads, dicompress, min_alignment, &dir] {
+    std::function<void()> ic_task = [&logger, threads, &output_dir, debug, &gfa_file, &corrected_reads, &reads, filter, dicompress, min_alignment, &dir] {
         io::SeqReader reader(corrected_reads);
         multigraph::MultiGraph vertex_graph;
         vertex_graph.LoadGFA(gfa_file, true);
         multigraph::MultiGraph edge_graph = vertex_graph.DBG();
         std::vector<Contig> contigs = edge_graph.getEdges(false);
         auto res = PrintAlignments(logger, threads, contigs, reader.begin(), reader.end(), min_alignment, dir);
-        std::vector<Contig> uncompressed = Polish(logger, threads, contigs, res.first, reads, dicompress);
+        std::vector<Contig> uncompressed = Polish(logger, threads, contigs, res.first, reads, dicompress, filter);
         std::vector<Contig> assembly = printUncompressedResults(logger, threads, edge_graph, uncompressed, output_dir, debug);
         logger.info() << "Printing final assembly to " << (output_dir / "assembly.fasta") << std::endl;
         std::ofstream os_cut;
@@ -325,6 +342,20 @@ std::string constructMessage() {
     ss << "  -k <int>                                      Value of k used for initial error correction.\n";
     ss << "  -K <int>                                      Value of k used for final error correction and initialization of multiDBG.\n";
     ss << "  --diploid                                     Use this option for diploid genomes. By default LJA assumes that the genome is haploid or inbred.\n";
+    ss << "  --no-read-cache                               Do not store compressed reads in a binary cache in the output folder. Reads will be parsed and compressed again at every stage.\n";
+    ss << "  --narrow-minimizer-hash                       Select minimizers with 64-bit hashes also when the window is shorter than k (e.g. for the K-mer-size phase). This makes minimizer selection faster at the cost of rehashing selected k-mers.\n";
+    ss << "  --minimizer-scheme <standard|robust|syncmer>  Scheme used to select minimizers that become vertices of the sparse de Bruijn graph. Robust winnowing selects fewer minimizers in low complexity regions, syncmers do not depend on neighbouring k-mers but are denser for long windows. The default value is standard.\n";
+    ss << "  --syncmer-length <int>                        Length of s-mers for the syncmer scheme. The default value 0 gives the same density as window minimizers when possible.\n";
+    ss << "  --minimizer-memory <float>                    Memory in Gb for collection of minimizers in the first phase. If set, distinct minimizers are collected in per thread hash sets that are spilled to the output folder as sorted runs. The default value is 0 (collect all minimizers in memory).\n";
+    ss << "  --junction-engine <bloom|exact>               Structure used to find junctions of the sparse de Bruijn graph. Exact engine keeps all distinct k+1-mers of disjointigs instead of a bloom filter and does not create extra vertices. It needs about 8 bytes per k+1-mer of disjointigs while they are collected and has no disk fallback, so all of them must fit in memory. The exact set is not saved with --save-junction-filter and can not be combined with --blocked-bloom. The default value is bloom.\n";
+    ss << "  --save-junction-filter                        Keep filled bloom filter in the output folder until junctions of the first phase are selected, so that a restart from junctions does not fill it again.\n";
+    ss << "  --blocked-bloom                               Use cache line blocked bloom filter for junction selection. It is faster for large genomes but has slightly higher false positive rate.\n";
+    ss << "  --density-report                              Estimate numbers of minimizers and vertices and memory usage for several values of k and w from a sample of reads and exit. This helps to choose k and w for a dataset before the assembly is started.\n";
+    ss << "  --density-sample <float>                      Fraction of reads used by the density report. The default value is 0.05.\n";
+    ss << "  --density-memory <float>                      Memory in Gb for which the density report recommends values of k and w. The default value is 0 (no recommendation).\n";
+    ss << "  --min-read-quality <float>                    Drop reads with mean base quality below this value. Mean quality is computed from mean error probability. The default value is 0 (no filtering).\n";
+    ss << "  --trim-quality <int>                          Trim read ends with base quality below this value. The default value is 0 (no trimming).\n";
+    ss << "  --min-read-length <int>                       Drop reads that are shorter than this value after trimming. The default value is 0 (no filtering).\n";
     return ss.str();
 }
 
@@ -349,6 +380,20 @@ int main(int argc, char **argv) {
                      "alternative",
                      "diploid",
                      "debug",
+                     "no-read-cache",
+                     "narrow-minimizer-hash",
+                     "minimizer-scheme=standard",
+                     "syncmer-length=0",
+                     "minimizer-memory=0",
+                     "blocked-bloom",
+                     "save-junction-filter",
+                     "junction-engine=bloom",
+                     "density-report",
+                     "density-sample=0.05",
+                     "density-memory=0",
+                     "min-read-quality=0",
+                     "trim-quality=0",
+                     "min-read-length=0",
                      "help"},
                     {"reads", "paths", "ref"},
                     {"o=output-dir", "t=threads", "k=k-mer-size","w=window", "K=K-mer-size","W=Window", "h=help"},
@@ -372,6 +417,12 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    if(parser.getCheck("blocked-bloom") && parser.getValue("junction-engine") == "exact") {
+        std::cout << "Options blocked-bloom and junction-engine exact can not be used together." << std::endl;
+        std::cout << parser.message() << std::endl;
+        return 1;
+    }
+
     bool debug = parser.getCheck("debug");
     StringContig::homopolymer_compressing = true;
     StringContig::SetDimerParameters(parser.getValue("dimer-compress"));
@@ -391,6 +442,13 @@ int main(int argc, char **argv) {
     bool skip = first_stage != "none";
     bool load = parser.getCheck("load");
     bool noec = parser.getCheck("noec");
+    MinimizerHashing::force_narrow = parser.getCheck("narrow-minimizer-hash");
+    MinimizerHashing::scheme = MinimizerHashing::parseScheme(parser.getValue("minimizer-scheme"));
+    MinimizerHashing::syncmer_length = std::stoull(parser.getValue("syncmer-length"));
+    MinimizerHashing::memory_budget = size_t(std::stod(parser.getValue("minimizer-memory")) * 1024 * 1024 * 1024);
+    JunctionFinding::blocked_bloom = parser.getCheck("blocked-bloom");
+    JunctionFinding::save_filter = parser.getCheck("save-junction-filter");
+    JunctionFinding::engine = JunctionFinding::parseEngine(parser.getValue("junction-engine"));
     logger.info() << "LJA pipeline started" << std::endl;
 
     size_t threads = std::stoi(parser.getValue("threads"));
@@ -409,9 +467,44 @@ int main(int argc, char **argv) {
     size_t KmDBG = std::stoi(parser.getValue("KmDBG"));
     size_t unique_threshold = std::stoi(parser.getValue("unique-threshold"));
 
+    if(parser.getCheck("density-report")) {
+        MinimizerDensityReport(logger, lib, std::stod(parser.getValue("density-sample")),
+                               size_t(std::stod(parser.getValue("density-memory")) * 1024 * 1024 * 1024),
+                               k, w, K, W, threads);
+        return 0;
+    }
+
+    io::Library reads_lib = lib;
+    bool first_phase = first_stage == "none" || first_stage == "junctions" || (!noec && first_stage == "alternative");
+    io::ReadFilter filter(std::stod(parser.getValue("min-read-quality")), std::stoull(parser.getValue("trim-quality")),
+                          std::stoull(parser.getValue("min-read-length")));
+//    Filtered reads are only stored in the read cache, so filtering always builds it
+    if(first_phase && filter.enabled() && parser.getCheck("no-read-cache"))
+        logger.info() << "Read filtering requires read cache. Option no-read-cache is ignored." << std::endl;
+    const std::experimental::filesystem::path read_cache = dir / ("reads" + io::read_cache_extension);
+    if(first_phase && (filter.enabled() || !parser.getCheck("no-read-cache"))) {
+        reads_lib = io::PrepareReadCache(logger, lib, read_cache, threads, filter);
+    } else if(filter.enabled()) {
+//        Later stages must use the same filtered reads as the stages they continue
+        if(!io::ReadCacheUpToDate(lib, read_cache, filter)) {
+            logger.info() << "Restart from stage " << first_stage << " with read filtering requires read cache " << read_cache
+                          << " built with the same reads and filter settings. Restart from an earlier stage." << std::endl;
+            return 1;
+        }
+        logger.info() << "Using existing read cache " << read_cache << std::endl;
+        reads_lib = {read_cache};
+    }
+
+//    Restart of the first phase from junction selection. Disjointigs are loaded and vertices are either loaded or
+//    selected again if the previous run stopped before they were saved. Bloom filter saved with
+//    --save-junction-filter is reused then.
+    if(first_stage == "junctions") {
+        skip = false;
+        load = true;
+    }
     std::vector<std::experimental::filesystem::path> corrected_final;
     if(noec) {
-        corrected_final = NoCorrection(logger, dir / ("k" + itos(K)), lib, {}, paths, threads, K, W,
+        corrected_final = NoCorrection(logger, dir / ("k" + itos(K)), reads_lib, {}, paths, threads, K, W,
                                        skip, debug, load);
     } else {
         double threshold = std::stod(parser.getValue("cov-threshold"));
@@ -419,9 +512,9 @@ int main(int argc, char **argv) {
         std::pair<std::experimental::filesystem::path, std::experimental::filesystem::path> corrected1;
         if (first_stage == "alternative")
             skip = false;
-        corrected1 = AlternativeCorrection(logger, dir / ("k" + itos(k)), lib, {}, paths, threads, k, w,
+        corrected1 = AlternativeCorrection(logger, dir / ("k" + itos(k)), reads_lib, {}, paths, threads, k, w,
                                            threshold, reliable_coverage, false, false, skip, debug, load);
-        if (first_stage == "alternative" || first_stage == "none")
+        if (first_stage == "alternative" || first_stage == "junctions" || first_stage == "none")
             load = false;
 
         double Threshold = std::stod(parser.getValue("Cov-threshold"));
@@ -447,7 +540,7 @@ int main(int argc, char **argv) {
     std::vector<std::experimental::filesystem::path> uncompressed_results =
             PolishingPhase(logger, threads, dir/ "uncompressing", dir, resolved[1],
                            corrected_final[0],
-                           lib, StringContig::max_dimer_size / 2, K, skip, debug);
+                           lib, filter.enabled() ? &filter : nullptr, StringContig::max_dimer_size / 2, K, skip, debug);
     if(first_stage == "polishing")
         load = false;
     logger.info() << "Final homopolymer compressed and corrected reads can be found here: " << corrected_final[0] << std::endl;
@@ -456,6 +549,5 @@ int main(int argc, char **argv) {
     logger.info() << "Final assembly can be found here: " << uncompressed_results[0] << std::endl;
     logger.info() << "LJA pipeline finished" << std::endl;
     cout << "LJA total time: " << t.get() << endl;
-    hashing::KWH::print_times();
     return 0;
 }
@@ -1,8 +1,10 @@
 #include "homopolish.hpp"
 #include <sequences/contigs.hpp>
+#include <sequences/compression_kernel.hpp>
 #include <common/cl_parser.hpp>
 #include <common/logging.hpp>
 #include <sequences/seqio.hpp>
+#include <sequences/read_index.hpp>
 #include <common/omp_utils.hpp>
 #include <common/zip_utils.hpp>
 #include <unordered_set>
@@ -502,18 +504,24 @@ struct AssemblyInfo {
         return cigars;
     }
 
-    string compressRead(const string& read, vector<size_t>& uncompressed_positions) {
-//TODO:: is it fast?
-//        logger.trace() << read << endl;
+//    Homopolymers are compressed by the shared kernel, then dinucleotide repeats longer than compression_length are
+//    collapsed. For every character of the result uncompressed_positions receives its position in read and quantities
+//    the length of its homopolymer run.
+    string compressRead(const string& read, vector<size_t>& uncompressed_positions, vector<size_t>& quantities) {
+        string hp_read(read.size(), 'A');
+        vector<uint32_t> run_lengths(read.size());
+        hp_read.resize(hpc::CompressToChars(read.data(), read.size(), hpc::NO_DIMER_COMPRESSION,
+                                            hpc::NO_DIMER_COMPRESSION, &hp_read[0], run_lengths.data()));
         string res;
-        size_t current_coord = 0;
-        uncompressed_positions.resize(0);
-        for (size_t i = 0; i < read.length(); i++) {
+        res.reserve(hp_read.size());
+        uncompressed_positions.clear();
+        quantities.clear();
+        size_t run_start = 0;
+        for (size_t i = 0; i < hp_read.size(); i++) {
+            size_t current_coord = res.size();
             bool compressed = false;
-            if (i > 0 && read[i] == read[i - 1]) {
-                compressed = true;
-            } else if (current_coord > 2*compression_length) {
-                bool in_repeat = (read[i] ==res[current_coord - 2] || read[i] == res[current_coord - 1]);
+            if (current_coord > 2*compression_length) {
+                bool in_repeat = (hp_read[i] ==res[current_coord - 2] || hp_read[i] == res[current_coord - 1]);
                 if (in_repeat) {
                     for (size_t j = 1; j < compression_length; j++) {
                         if (res[current_coord  - 2 * j] != res[current_coord -2]) {
@@ -530,15 +538,15 @@ struct AssemblyInfo {
                         }
                     }
                 }
-                compressed |= in_repeat;
+                compressed = in_repeat;
             }
             if (!compressed) {
-                res = std::move(res) + read[i];
-                uncompressed_positions.push_back(i);
-                current_coord ++;
+                res += hp_read[i];
+                uncompressed_positions.push_back(run_start);
+                quantities.push_back(run_lengths[i]);
             }
+            run_start += run_lengths[i];
         }
-//        logger.trace() << res.str() << endl;
         return res;
     }
 
@@ -550,14 +558,15 @@ struct AssemblyInfo {
         Sequence uncompressed_read_seq (read);
         size_t rlen = read.length();
         vector<size_t> compressed_read_coords;
+        vector<size_t> quantities;
         string compressed_read;
         if (aln.rc) {
             uncompressed_read_seq = !uncompressed_read_seq;
-            compressed_read = compressRead(uncompressed_read_seq.str(), compressed_read_coords);
+            compressed_read = compressRead(uncompressed_read_seq.str(), compressed_read_coords, quantities);
             RC(aln, compressed_read.length());
 //            read = read.RC();
         } else {
-            compressed_read = compressRead(uncompressed_read_seq.str(), compressed_read_coords);
+            compressed_read = compressRead(uncompressed_read_seq.str(), compressed_read_coords, quantities);
         }
         logger.debug() << aln.read_id << " "<<  aln.alignment_start << " " << aln.alignment_end << endl;
         ContigInfo& current_contig = contigs[aln.contig_id];
@@ -573,19 +582,6 @@ struct AssemblyInfo {
             logger.debug()<< "Read " << aln.read_id << " not aligned " << endl;
             return;
         }
-        int cur_ind = 0;
-        std:vector<size_t> quantities;
-        quantities.resize(compressed_read.length());
-
-        for (size_t i = 0; i < compressed_read.size(); i++){
-            size_t count = 0;
-            cur_ind = compressed_read_coords[i];
-            while (cur_ind < uncompressed_read_seq.size() && nucl(uncompressed_read_seq[cur_ind]) == compressed_read[i]) {
-                count ++;
-                cur_ind ++;
-            }
-            quantities[i] = count;
-        }
         size_t cont_coords = 0; //minimapaln[0].seg_to.left;
         size_t read_coords = 0; //minimapaln[0].seg_from.left;
         read_coords = aln.read_start;
@@ -672,13 +668,74 @@ struct AssemblyInfo {
         cout << "processBatch time: " << t.get() << endl;
     }
 
-    vector<Contig> process(logging::Logger &logger, const io::Library &lib,
-                           const std::experimental::filesystem::path &alignmens_file) {
-        logging::TimeSpace t;
+//    Alignments are read in batches and reads of every batch are fetched by id on all threads,
+//    so the order of alignments does not have to match the order of reads.
+    void processIndexed(logging::Logger &logger, const io::Library &lib,
+                        const std::experimental::filesystem::path &alignmens_file, io::ReadFilter *filter) {
+        std::ifstream compressed_reads(alignmens_file);
+        logger.info() << "Indexing initial reads from " << lib << "\n";
+        io::ReadIndex index(lib);
+        io::RandomAccessReader reader(index);
+        logger.info() << "Indexed " << index.size() << " reads" << endl;
+        size_t aln_count = 0;
+        size_t missing = 0;
+        vector<AlignmentInfo> align_batch;
+        vector<string> contig_batch;
+        while (true) {
+            AlignmentInfo cur_align = readAlignment(compressed_reads);
+            bool over = cur_align.read_id.empty();
+            if (!over)
+                align_batch.push_back(std::move(cur_align));
+            if (align_batch.size() < BATCH_SIZE && !over)
+                continue;
+            contig_batch.assign(align_batch.size(), "");
+            size_t len = align_batch.size();
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:missing)
+            for (size_t i = 0; i < len; i++) {
+                if (i > 0 && align_batch[i].read_id == align_batch[i - 1].read_id)
+                    continue;
+                StringContig read;
+                if (reader.read(align_batch[i].read_id, read, filter))
+                    contig_batch[i] = std::move(read.seq);
+                else
+                    missing++;
+            }
+            for (size_t i = 1; i < len; i++) {
+                if (align_batch[i].read_id == align_batch[i - 1].read_id)
+                    contig_batch[i] = contig_batch[i - 1];
+            }
+            size_t found = 0;
+            for (size_t i = 0; i < len; i++) {
+                if (contig_batch[i].empty())
+                    continue;
+                if (found != i) {
+                    align_batch[found] = std::move(align_batch[i]);
+                    contig_batch[found] = std::move(contig_batch[i]);
+                }
+                found++;
+            }
+            align_batch.resize(found);
+            contig_batch.resize(found);
+            processBatch(logger, contig_batch, align_batch);
+            aln_count += len;
+            logger.trace() << "Processed " << aln_count << " compressed mappings " << endl;
+            align_batch.clear();
+            contig_batch.clear();
+            if (over)
+                break;
+        }
+        if (missing > 0)
+            logger.info() << missing << " aligned reads were not found in " << lib << endl;
+    }
+
+//    Used when reads can not be accessed by id, e.g. for plain gzip files. Alignments must be sorted in the same
+//    order as reads.
+    void processSequential(logging::Logger &logger, const io::Library &lib,
+                           const std::experimental::filesystem::path &alignmens_file, io::ReadFilter *filter) {
         std::ifstream compressed_reads;
         std::ofstream corrected_contigs;
         compressed_reads.open(alignmens_file);
-        io::SeqReader reader(lib);
+        io::SeqReader reader = filter == nullptr ? io::SeqReader(lib) : io::SeqReader(lib, *filter);
         logger.trace() << "Initialized\n";
         if (compressed_reads.eof()) {
             logger.info() << "NO ALIGNMENTS AVAILABLE!";
@@ -738,6 +795,19 @@ struct AssemblyInfo {
         }
         processBatch(logger, contig_batch, align_batch);
         logger.trace() << "Processed final batch of " << align_batch.size() << " compressed reads " << endl;
+    }
+
+//    Reads are passed through the filter that was used for the reads that were aligned, so that alignment coordinates
+//    refer to the same trimmed sequences.
+    vector<Contig> process(logging::Logger &logger, const io::Library &lib,
+                           const std::experimental::filesystem::path &alignmens_file, io::ReadFilter *filter) {
+        logging::TimeSpace t;
+        if (io::ReadIndex::Indexable(lib)) {
+            processIndexed(logger, lib, alignmens_file, filter);
+        } else {
+            logger.info() << "Reads can not be accessed by id, reading them sequentially" << endl;
+            processSequential(logger, lib, alignmens_file, filter);
+        }
         vector<Contig> res;
         logger.info() << "Uncompressing homopolymers in contigs" << endl;
         for (auto& contig: contigs){
@@ -758,9 +828,9 @@ struct AssemblyInfo {
 std::vector<Contig> Polish(logging::Logger &logger, size_t threads,
                                            const std::vector<Contig> &contigs,
                                            const std::experimental::filesystem::path &alignments,
-                                           const io::Library &reads, size_t dicompress) {
+                                           const io::Library &reads, size_t dicompress, io::ReadFilter *filter) {
     omp_set_num_threads(threads);
     AssemblyInfo assemblyInfo(logger, contigs, dicompress);
-    return std::move(assemblyInfo.process(logger, reads, alignments));
+    return std::move(assemblyInfo.process(logger, reads, alignments, filter));
 }
 
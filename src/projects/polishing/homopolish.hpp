@@ -5,4 +5,5 @@
 std::vector<Contig> Polish(logging::Logger &logger, size_t threads,
                                            const std::vector<Contig> &contigs_file,
                                            const std::experimental::filesystem::path &alignments,
-                                           const io::Library &reads, size_t dicompress);
+                                           const io::Library &reads, size_t dicompress,
+                                           io::ReadFilter *filter = nullptr);
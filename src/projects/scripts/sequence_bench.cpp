@@ -0,0 +1,101 @@
+#include <sequences/packing_kernel.hpp>
+#include <sequences/sequence.hpp>
+#include <common/cl_parser.hpp>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Compares vectorized packing, unpacking and reverse complement of Sequence with the scalar implementations.
+namespace {
+    double measure(size_t rounds, const std::function<void()> &task) {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < rounds; i++)
+            task();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const std::string &name, double scalar, double simd, size_t bases) {
+        std::cout << name << ": scalar " << bases / scalar / 1e6 << " Mbp/s, vectorized " << bases / simd / 1e6
+                  << " Mbp/s, speedup " << scalar / simd << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"reads=1000", "length=20000", "rounds=10"}, {}, {});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    const size_t reads = std::stoull(parser.getValue("reads"));
+    const size_t length = std::stoull(parser.getValue("length"));
+    const size_t rounds = std::stoull(parser.getValue("rounds"));
+    std::mt19937_64 rnd(239);
+    std::vector<std::string> strings(reads);
+    for(std::string &s : strings) {
+        s.resize(length);
+        for(char &c : s)
+            c = "ACGT"[rnd() & 3u];
+    }
+    std::vector<std::vector<uint64_t>> packed(reads, std::vector<uint64_t>(packing::Words(length)));
+    std::string buffer(length, '-');
+    const size_t bases = reads * length * rounds;
+    size_t checksum = 0;
+
+    double scalar = measure(rounds, [&]() {
+        for(size_t i = 0; i < reads; i++)
+            packing::scalar::Pack(strings[i].data(), length, packed[i].data());
+    });
+    double simd = measure(rounds, [&]() {
+        for(size_t i = 0; i < reads; i++)
+            packing::Pack(strings[i].data(), length, packed[i].data());
+    });
+    report("Pack", scalar, simd, bases);
+
+    scalar = measure(rounds, [&]() {
+        for(size_t i = 0; i < reads; i++) {
+            packing::scalar::Unpack(packed[i].data(), length, &buffer[0]);
+            checksum += buffer[i % length];
+        }
+    });
+    simd = measure(rounds, [&]() {
+        for(size_t i = 0; i < reads; i++) {
+            packing::Unpack(packed[i].data(), length, &buffer[0]);
+            checksum += buffer[i % length];
+        }
+    });
+    report("Unpack", scalar, simd, bases);
+
+    scalar = measure(rounds, [&]() {
+        for(size_t i = 0; i < reads; i++)
+            packing::scalar::ReverseComplement(packed[i].data(), length);
+    });
+    simd = measure(rounds, [&]() {
+        for(size_t i = 0; i < reads; i++)
+            packing::ReverseComplement(packed[i].data(), length);
+    });
+    report("Reverse complement", scalar, simd, bases);
+
+//    Reverse complement as Sequence users see it: reading a reverse complement view as a string
+    std::vector<Sequence> seqs;
+    for(const std::string &s : strings)
+        seqs.emplace_back(s);
+    scalar = measure(rounds, [&]() {
+        for(const Sequence &seq : seqs) {
+            Sequence rc = !seq;
+            for(size_t j = 0; j < length; j++)
+                buffer[j] = nucl(rc[j]);
+            checksum += buffer[0];
+        }
+    });
+    simd = measure(rounds, [&]() {
+        for(const Sequence &seq : seqs)
+            checksum += (!seq).str()[0];
+    });
+    report("Sequence reverse complement to string", scalar, simd, bases);
+    std::cout << "Checksum " << checksum << std::endl;
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "dbg/sparse_dbg.hpp"
+#include "gtest/gtest.h"
+#include <string>
+
+TEST(EdgeArena, StableReferencesAndReuse) {
+    dbg::EdgeArena<std::string> arena;
+    std::vector<uint32_t> ids;
+    for(size_t i = 0; i < 200000; i++)
+        ids.push_back(arena.emplace(std::to_string(i)));
+    std::string *first = &arena[ids[0]];
+    for(size_t i = 0; i < 200000; i++)
+        ASSERT_EQ(arena[ids[i]], std::to_string(i));
+    ASSERT_EQ(first, &arena[ids[0]]);
+    arena.release(ids[5]);
+    ASSERT_EQ(arena.size(), 199999);
+    ASSERT_EQ(arena.emplace("reused"), ids[5]);
+    ASSERT_EQ(arena[ids[5]], "reused");
+}
+
+TEST(EdgeIdList, GrowsBeyondInlineIds) {
+    dbg::EdgeIdList list;
+    for(uint32_t i = 0; i < 10; i++) {
+        list.push_back(i * 7);
+        ASSERT_EQ(list.size(), i + 1);
+        for(uint32_t j = 0; j <= i; j++)
+            ASSERT_EQ(list[j], j * 7);
+    }
+    list.clear();
+    ASSERT_EQ(list.size(), 0);
+    list.push_back(3);
+    ASSERT_EQ(list[0], 3);
+}
+
+TEST(EdgeArena, OutgoingEdgesOfStandaloneVertex) {
+    dbg::Vertex vertex(1);
+    vertex.seq = Sequence("ACGTA");
+    for(const char *seq : {"C", "AT", "GGC"})
+        vertex.addEdge(dbg::Edge(&vertex, nullptr, Sequence(seq)));
+    dbg::OutgoingIterator it = vertex.begin();
+    ASSERT_EQ(vertex.end() - it, 3);
+    ASSERT_EQ(it[1].seq, Sequence("AT"));
+    it += 2;
+    ASSERT_TRUE(it < vertex.end());
+    ASSERT_EQ(it->seq, Sequence("GGC"));
+    ASSERT_TRUE(it - 2 == vertex.begin());
+    ASSERT_EQ(std::distance(vertex.begin(), vertex.end()), 3);
+}
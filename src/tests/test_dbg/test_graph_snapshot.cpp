@@ -0,0 +1,75 @@
+#include "dbg/graph_snapshot.hpp"
+#include "gtest/gtest.h"
+#include <random>
+
+TEST(GraphSnapshot, RoundTrip) {
+    std::experimental::filesystem::path dir =
+            std::experimental::filesystem::temp_directory_path() / "lja_graph_snapshot_test";
+    logging::Logger logger;
+    const size_t k = 11;
+    hashing::RollingHash hasher(k, 239);
+    std::mt19937_64 rnd(239);
+    dbg::SparseDBG dbg(hasher);
+    std::vector<Sequence> fulls;
+    for(size_t i = 0; i < 30; i++) {
+        std::string s;
+        for(size_t j = 0; j < k + 3 + i; j++)
+            s += "ACGT"[rnd() % 4];
+        Sequence full(s);
+        dbg::Vertex &start = dbg.addVertex(full.Subseq(0, k));
+        dbg::Vertex &end = dbg.addVertex(full.Subseq(full.size() - k));
+        start.addEdge(dbg::Edge(&start, &end, full.Subseq(k)));
+        end.rc().addEdge(dbg::Edge(&end.rc(), &start.rc(), (!full).Subseq(k)));
+        start.getOutgoing(full[k]).incCov(i + 1);
+        fulls.push_back(full);
+    }
+    dbg.addVertex(Sequence("GATTACAGATTACA").Subseq(0, k));
+    dbg::Vertex &hanging = dbg.addVertex(Sequence("CCCTTTAAAGGG").Subseq(0, k));
+    hanging.addEdge(dbg::Edge(&hanging, nullptr, Sequence("ACGTTGCA")));
+    ReadLogger readLogger(1, dir.string() + ".log");
+    RecordStorage reads(dbg, 0, 100000, 1, readLogger, false, false);
+    for(size_t i = 0; i < fulls.size(); i++) {
+        dbg::Vertex &start = dbg.getVertex(fulls[i].Subseq(0, k));
+        reads.addRead(AlignedRead("read" + std::to_string(i), dbg::CompactPath(start, fulls[i].Subseq(k, k + 1), 1, 2)));
+    }
+    reads.addRead(AlignedRead("unaligned"));
+    dbg::SaveGraphSnapshot(logger, dir, dbg, {&reads});
+    ASSERT_TRUE(dbg::IsGraphSnapshot(dir, k));
+    ASSERT_FALSE(dbg::IsGraphSnapshot(dir, k + 2));
+
+    dbg::SparseDBG loaded = dbg::LoadGraphSnapshot(logger, dir, hasher, 2);
+    ASSERT_EQ(loaded.size(), dbg.size());
+    for(auto &it : dbg) {
+        for(dbg::Vertex *vertex : {&it.second, &it.second.rc()}) {
+            dbg::Vertex &other = loaded.getVertex(vertex->hash(), vertex->isCanonical());
+            ASSERT_EQ(other.seq, vertex->seq);
+            ASSERT_EQ(other.rc().seq, !vertex->seq);
+            ASSERT_EQ(other.outDeg(), vertex->outDeg());
+            for(size_t i = 0; i < vertex->outDeg(); i++) {
+                ASSERT_EQ(other[i].seq, (*vertex)[i].seq);
+                ASSERT_EQ(other[i].end() == nullptr, (*vertex)[i].end() == nullptr);
+                if((*vertex)[i].end() != nullptr)
+                    ASSERT_EQ(other[i].end()->seq, (*vertex)[i].end()->seq);
+                ASSERT_EQ(other[i].intCov(), (*vertex)[i].intCov());
+            }
+        }
+    }
+    RecordStorage loaded_reads(loaded, 0, 100000, 1, readLogger, true, false);
+    dbg::LoadSnapshotReads(logger, dir, {&loaded_reads}, loaded);
+    ASSERT_EQ(loaded_reads.size(), reads.size());
+    for(size_t i = 0; i < reads.size(); i++) {
+        ASSERT_EQ(loaded_reads[i].id, reads[i].id);
+        ASSERT_EQ(loaded_reads[i].path.valid(), reads[i].path.valid());
+        if(!reads[i].path.valid())
+            continue;
+        ASSERT_EQ(loaded_reads[i].path.start().seq, reads[i].path.start().seq);
+        ASSERT_EQ(loaded_reads[i].path.cpath(), reads[i].path.cpath());
+        ASSERT_EQ(loaded_reads[i].path.leftSkip(), 1);
+        ASSERT_EQ(loaded_reads[i].path.rightSkip(), 2);
+    }
+    for(auto &it : dbg)
+        for(dbg::Edge &edge : it.second)
+            ASSERT_EQ(loaded.getVertex(it.first).getOutgoing(edge.seq[0]).intCov(), edge.intCov());
+    std::experimental::filesystem::remove_all(dir);
+    std::experimental::filesystem::remove(dir.string() + ".log");
+}
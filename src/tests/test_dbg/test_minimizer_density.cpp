@@ -0,0 +1,52 @@
+#include "dbg/minimizer_density.hpp"
+#include "dbg/minimizer_selection.hpp"
+#include "common/dir_utils.hpp"
+#include "gtest/gtest.h"
+#include <random>
+#include <unordered_set>
+
+TEST(MinimizerDensity, EstimateMatchesExactCount) {
+    std::experimental::filesystem::path dir =
+            std::experimental::filesystem::temp_directory_path() / "lja_minimizer_density_test";
+    ensure_dir_existance(dir);
+    const size_t k = 31;
+    const size_t w = 50;
+    std::mt19937_64 rnd(239);
+    std::string genome;
+    for(size_t i = 0; i < 100000; i++)
+        genome += "ACGT"[rnd() % 4];
+    std::ofstream os(dir / "reads.fasta");
+    std::vector<Sequence> reads;
+    for(size_t i = 0; i < 400; i++) {
+        size_t pos = rnd() % (genome.size() - 5000);
+        Sequence read(genome.substr(pos, 5000));
+        if(i % 2 == 1)
+            read = !read;
+        os << ">read" << i << "\n" << read.str() << "\n";
+        reads.emplace_back(read);
+    }
+    os.close();
+    logging::Logger logger;
+    const double fraction = 0.5;
+    std::vector<Sequence> sample = SampleReads(logger, {dir / "reads.fasta"}, fraction, 1);
+    ASSERT_GE(sample.size(), 195);
+    ASSERT_LE(sample.size(), 205);
+    ASSERT_EQ(sample.front(), reads.front());
+
+    const hashing::BasicRollingHash<hashing::htype64> hasher = hashing::RollingHash(k, 239).narrow<hashing::htype64>();
+    hashing::BasicMinimizerEngine<hashing::htype64> engine(hasher, w, MinimizerHashing::scheme,
+                                                           MinimizerHashing::syncmer_length);
+    std::unordered_set<hashing::htype64> distinct;
+    std::vector<hashing::BasicHashedKmer<hashing::htype64>> kmers;
+    for(const Sequence &read : reads) {
+        kmers.clear();
+        engine.minimizers(read, kmers);
+        for(const hashing::BasicHashedKmer<hashing::htype64> &kmer : kmers)
+            distinct.emplace(kmer.hash());
+    }
+    MinimizerDensityEstimate est = EstimateMinimizerDensity(sample, fraction, k, w, true, 1);
+    ASSERT_TRUE(est.reliable);
+    ASSERT_NEAR(est.distinct_minimizers, double(distinct.size()), 0.1 * distinct.size());
+    ASSERT_NEAR(est.coverage, 20.0, 4.0);
+    std::experimental::filesystem::remove_all(dir);
+}
@@ -0,0 +1,51 @@
+#include "dbg/vertex_table.hpp"
+#include "gtest/gtest.h"
+#include <random>
+#include <unordered_set>
+
+struct TestVertex {
+    hashing::htype hash;
+    TestVertex *twin;
+    bool canonical;
+
+    TestVertex(hashing::htype hash, TestVertex &twin, bool canonical) : hash(hash), twin(&twin), canonical(canonical) {
+    }
+};
+
+TEST(VertexTable, BuildFindErase) {
+    std::mt19937_64 rnd(239);
+    std::vector<hashing::htype> keys(100000);
+    for(hashing::htype &key : keys)
+        key = (hashing::htype(rnd()) << 64u) | rnd();
+    std::vector<hashing::htype> input = keys;
+    input.insert(input.end(), keys.begin(), keys.begin() + 1000);
+    dbg::VertexTable<TestVertex> table;
+    table.build(input.begin(), input.end(), 4);
+    ASSERT_EQ(table.size(), keys.size());
+    for(hashing::htype key : keys) {
+        auto it = table.find(key);
+        ASSERT_TRUE(it != table.end());
+        ASSERT_EQ(it->first, key);
+        ASSERT_TRUE(it->second.canonical);
+        ASSERT_FALSE(it->second.twin->canonical);
+        ASSERT_EQ(it->second.twin->twin, &it->second);
+    }
+    ASSERT_TRUE(table.find(0) == table.end());
+    std::unordered_set<hashing::htype> erased;
+    for(auto it = table.begin(); it != table.end();) {
+        if(it->first % 3 == 0) {
+            erased.insert(it->first);
+            it = table.erase(it);
+        } else
+            ++it;
+    }
+    ASSERT_EQ(table.size(), keys.size() - erased.size());
+    for(size_t i = 0; i < 1000; i++)
+        ASSERT_TRUE(table.emplace(keys[i]).second == (erased.find(keys[i]) != erased.end()));
+    size_t cnt = 0;
+    for(auto &pair : table) {
+        ASSERT_TRUE(table.find(pair.first) != table.end());
+        cnt++;
+    }
+    ASSERT_EQ(cnt, table.size());
+}
@@ -0,0 +1,30 @@
+#include "common/binary_array.hpp"
+#include "common/hash_utils.hpp"
+#include "gtest/gtest.h"
+#include <random>
+
+TEST(BinaryArray, RoundTripAndValidation) {
+    std::experimental::filesystem::path file =
+            std::experimental::filesystem::temp_directory_path() / "lja_binary_array_test.bin";
+    std::mt19937_64 rnd(239);
+    std::vector<hashing::htype> values(1001);
+    for(hashing::htype &value : values)
+        value = (hashing::htype(rnd()) << 64u) + rnd();
+    WriteBinaryArray(file, values, 501);
+    ASSERT_TRUE(IsBinaryArray(file));
+    {
+        MappedArray<hashing::htype> mapped(file, 501);
+        ASSERT_TRUE(mapped.valid());
+        ASSERT_EQ(std::vector<hashing::htype>(mapped.begin(), mapped.end()), values);
+        ASSERT_FALSE(MappedArray<hashing::htype>(file, 5001).valid());
+        ASSERT_FALSE(MappedArray<uint64_t>(file, 501).valid());
+    }
+    {
+        std::fstream fs(file, std::ios::binary | std::ios::in | std::ios::out);
+        fs.seekp(sizeof(BinaryArrayHeader) + 100);
+        fs.put(char(fs.peek() ^ 1));
+    }
+    ASSERT_FALSE(MappedArray<hashing::htype>(file, 501).valid());
+    std::experimental::filesystem::remove(file);
+    ASSERT_FALSE(MappedArray<hashing::htype>(file, 501).valid());
+}
@@ -0,0 +1,77 @@
+#include "common/bloom_filter.hpp"
+#include "common/partitioned_hash_set.hpp"
+#include "gtest/gtest.h"
+#include <random>
+
+TEST(BlockedBloomFilter, NoFalseNegatives) {
+    bloom_parameters parameters;
+    parameters.projected_element_count = 100000;
+    parameters.false_positive_probability = 0.0001;
+    parameters.compute_optimal_parameters();
+    BlockedBloomFilter filter(parameters);
+    std::mt19937_64 rnd(239);
+    std::vector<uint64_t> keys(100000);
+    for(uint64_t &key : keys)
+        key = rnd();
+#pragma omp parallel for
+    for(size_t i = 0; i < keys.size(); i++)
+        filter.insert(keys[i]);
+    for(uint64_t key : keys)
+        ASSERT_TRUE(filter.contains(key));
+    size_t false_positives = 0;
+    for(size_t i = 0; i < 100000; i++)
+        false_positives += filter.contains(rnd());
+    ASSERT_LT(false_positives, 100u);
+    std::pair<size_t, size_t> bits = filter.count_bits();
+    ASSERT_LE(bits.first, keys.size() * parameters.optimal_parameters.number_of_hashes);
+    ASSERT_GE(bits.second, parameters.optimal_parameters.table_size);
+}
+
+TEST(PartitionedHashSet, Exact) {
+    PartitionedHashSet set(4);
+    std::mt19937_64 rnd(17);
+    std::vector<uint64_t> keys(50000);
+    for(uint64_t &key : keys)
+        key = rnd() >> 1u << 1u;
+    omp_set_num_threads(4);
+#pragma omp parallel for
+    for(size_t i = 0; i < keys.size() * 2; i++)
+        set.insert(keys[i % keys.size()]);
+    set.build(4);
+    ASSERT_EQ(set.size(), keys.size());
+    for(uint64_t key : keys) {
+        ASSERT_TRUE(set.contains(key));
+        ASSERT_FALSE(set.contains(key + 1));
+    }
+}
+
+TEST(BloomFilter, ContainsBatch) {
+    bloom_parameters parameters;
+    parameters.projected_element_count = 10000;
+    parameters.false_positive_probability = 0.0001;
+    parameters.compute_optimal_parameters();
+    BloomFilter filter(parameters);
+    BlockedBloomFilter blocked(parameters);
+    PartitionedHashSet set(1);
+    std::mt19937_64 rnd(5);
+    std::vector<uint64_t> keys(30000);
+    for(size_t i = 0; i < keys.size(); i++) {
+        keys[i] = rnd();
+        if(i % 3 == 0) {
+            filter.insert(keys[i]);
+            blocked.insert(keys[i]);
+            set.insert(keys[i]);
+        }
+    }
+    set.build(1);
+    std::vector<unsigned char> found(keys.size());
+    filter.containsBatch(keys.data(), keys.size(), found.data());
+    for(size_t i = 0; i < keys.size(); i++)
+        ASSERT_EQ(bool(found[i]), filter.contains(keys[i]));
+    blocked.containsBatch(keys.data(), keys.size(), found.data());
+    for(size_t i = 0; i < keys.size(); i++)
+        ASSERT_EQ(bool(found[i]), blocked.contains(keys[i]));
+    set.containsBatch(keys.data(), keys.size(), found.data());
+    for(size_t i = 0; i < keys.size(); i++)
+        ASSERT_EQ(bool(found[i]), i % 3 == 0);
+}
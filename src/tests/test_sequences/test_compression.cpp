@@ -0,0 +1,49 @@
+#include "sequences/compression_kernel.hpp"
+#include "sequences/contigs.hpp"
+#include "sequences/packing_kernel.hpp"
+#include "gtest/gtest.h"
+#include <vector>
+
+TEST(CompressionKernel, HomopolymerRuns) {
+    // Longer than one vector block so that the AVX2/SSE2 loop and the scalar tail are both used
+    std::string s = "AAACGGTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTACCCAGTNNA";
+    std::vector<uint32_t> runs(s.size());
+    std::string out = s;
+    out.resize(hpc::CompressToChars(&out[0], out.size(), hpc::NO_DIMER_COMPRESSION, hpc::NO_DIMER_COMPRESSION,
+                                    &out[0], runs.data()));
+    ASSERT_EQ(out, "ACGTACAGTNA");
+    std::vector<uint32_t> expected = {3, 1, 2, 38, 1, 3, 1, 1, 1, 2, 1};
+    ASSERT_EQ(std::vector<uint32_t>(runs.begin(), runs.begin() + out.size()), expected);
+}
+
+TEST(CompressionKernel, Dimers) {
+    std::string dimer;
+    for(size_t i = 0; i < 20; i++)
+        dimer += "AC";
+    std::string s = "GGT" + dimer + "GGAT";
+    std::vector<uint64_t> words(hpc::PackedWords(s.size()));
+    for(size_t max_dimer : {8, 9, 40}) {
+        std::string out = s;
+        out.resize(hpc::CompressToChars(&out[0], out.size(), 6, max_dimer, &out[0]));
+        size_t kept = max_dimer >= 40 ? 40 : 40 - (40 - max_dimer) / 2 * 2;
+        ASSERT_EQ(out, "GT" + dimer.substr(0, kept) + "GAT");
+        size_t len = hpc::CompressToWords(s.data(), s.size(), 6, max_dimer, words.data());
+        ASSERT_EQ(Sequence::FromPacked(words.data(), len), Sequence(out));
+    }
+}
+
+TEST(PackingKernel, NonACGTMatchesScalar) {
+    std::string s;
+    std::string letters = "ACGTNSWDRYKMBHVacgtnswdrykmbhv-*";
+    letters += std::string(1, char(1)) + char(2) + char(3) + char(0) + char(0xc1) + char(0xe7);
+    for(size_t i = 0; i < 4; i++)
+        s += letters;
+    for(size_t offset = 0; offset < 40; offset++) {
+        size_t n = s.size() - offset;
+        std::vector<uint64_t> vector_words(packing::Words(n));
+        std::vector<uint64_t> scalar_words(packing::Words(n));
+        packing::Pack(s.data() + offset, n, vector_words.data());
+        packing::scalar::Pack(s.data() + offset, n, scalar_words.data());
+        ASSERT_EQ(vector_words, scalar_words);
+    }
+}
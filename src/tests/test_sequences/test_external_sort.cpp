@@ -0,0 +1,26 @@
+#include "common/external_sort.hpp"
+#include "common/hash_utils.hpp"
+#include "gtest/gtest.h"
+#include <random>
+#include <set>
+
+TEST(ExternalDistinctCollector, MergesSpilledRuns) {
+    std::experimental::filesystem::path dir = std::experimental::filesystem::temp_directory_path() / "lja_external_sort_test";
+    std::experimental::filesystem::create_directories(dir);
+    std::mt19937_64 rnd(239);
+    std::set<hashing::htype> expected;
+    {
+        typedef ExternalDistinctCollector<hashing::htype, hashing::alt_hasher<hashing::htype>> Collector;
+        Collector collector(dir, "test", 3, 3 * 1024 * Collector::bytes_per_element);
+        for(size_t i = 0; i < 20000; i++) {
+            hashing::htype value = (hashing::htype(rnd() % 5000) << 64u) + 7;
+            expected.insert(value);
+            collector.add(i % 3, value);
+        }
+        ASSERT_GT(collector.runNumber(), 3u);
+        std::vector<hashing::htype> res = collector.collect();
+        ASSERT_EQ(res, std::vector<hashing::htype>(expected.begin(), expected.end()));
+    }
+    ASSERT_TRUE(std::experimental::filesystem::is_empty(dir));
+    std::experimental::filesystem::remove(dir);
+}
@@ -0,0 +1,149 @@
+#include "sequences/read_cache_writer.hpp"
+#include "sequences/read_index.hpp"
+#include "gtest/gtest.h"
+#include <sstream>
+
+namespace {
+    std::vector<StringContig> parseAll(const std::string &text, bool fastq, size_t block_size) {
+        std::stringstream ss(text);
+        io::FastxParser parser(ss, fastq, block_size);
+        std::vector<StringContig> res;
+        StringContig contig;
+        while(parser.next(contig))
+            res.emplace_back(std::move(contig));
+        return res;
+    }
+}
+
+TEST(FastxParser, MultilineFasta) {
+    std::string text = ">read1 first read\nACGT\nacgt\n\n>read2\r\nTTTT\r\n>read3\nGGCC";
+    for(size_t block_size : {3, 7, 1 << 20}) {
+        std::vector<StringContig> res = parseAll(text, false, block_size);
+        ASSERT_EQ(res.size(), 3);
+        ASSERT_EQ(res[0].id, "read1");
+        ASSERT_EQ(res[0].comment, "first read");
+        ASSERT_EQ(res[0].seq, "ACGTACGT");
+        ASSERT_EQ(res[1].id, "read2");
+        ASSERT_EQ(res[1].seq, "TTTT");
+        ASSERT_EQ(res[2].seq, "GGCC");
+    }
+}
+
+TEST(FastxParser, Fastq) {
+    std::string text = "@r1\nACGTA\n+\n@@@@@\n@r2\nCC\n+r2\n+@\n";
+    for(size_t block_size : {2, 5, 1 << 20}) {
+        std::vector<StringContig> res = parseAll(text, true, block_size);
+        ASSERT_EQ(res.size(), 2);
+        ASSERT_EQ(res[0].id, "r1");
+        ASSERT_EQ(res[0].seq, "ACGTA");
+        ASSERT_EQ(res[1].id, "r2");
+        ASSERT_EQ(res[1].seq, "CC");
+    }
+}
+
+TEST(FastxParser, QualityFilter) {
+    std::string text = "@r1\nAACGTTT\n+\n!IIIII!\n@r2\nACGT\n+\n++++\n@r3\nGG\n+\nII\n@r4\nACG\nTA\n+\nIII\nII\n";
+    for(size_t block_size : {3, 1 << 20}) {
+        io::ReadFilter filter(15, 10, 3);
+        std::stringstream ss(text);
+        io::FastxParser parser(ss, true, block_size, &filter);
+        std::vector<StringContig> res;
+        StringContig contig;
+        while(parser.next(contig))
+            res.emplace_back(std::move(contig));
+        ASSERT_EQ(res.size(), 2);
+        ASSERT_EQ(res[0].id, "r1");
+        ASSERT_EQ(res[0].seq, "ACGTT");
+        ASSERT_EQ(res[1].id, "r4");
+        ASSERT_EQ(res[1].seq, "ACGTA");
+        ASSERT_EQ(filter.reads, 4);
+        ASSERT_EQ(filter.bases, 18);
+        ASSERT_EQ(filter.passed_reads, 2);
+        ASSERT_EQ(filter.passed_bases, 10);
+    }
+}
+
+TEST(ReadCache, RoundTrip) {
+    bool old_compressing = StringContig::homopolymer_compressing;
+    StringContig::homopolymer_compressing = true;
+    std::experimental::filesystem::path dir = std::experimental::filesystem::temp_directory_path() / "lja_read_cache_test";
+    ensure_dir_existance(dir);
+    std::ofstream os(dir / "reads.fasta");
+    os << ">r1 comment\nAAACCCGGGTTTACGTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTGA\n>r2\nACGGGGT\n";
+    os.close();
+    logging::Logger logger;
+    io::Library lib = {dir / "reads.fasta"};
+    io::Library cache = io::PrepareReadCache(logger, lib, dir / ("reads" + io::read_cache_extension), 1);
+    std::vector<Contig> expected = io::SeqReader(lib).readAllContigs();
+    std::vector<Contig> cached = io::SeqReader(cache).readAllContigs();
+    ASSERT_EQ(cached.size(), expected.size());
+    for(size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(cached[i].id, expected[i].id);
+        ASSERT_EQ(cached[i].seq, expected[i].seq);
+        ASSERT_EQ((!cached[i].seq).str(), (!expected[i].seq).str());
+    }
+    io::MappedReadStore store(cache[0]);
+    ASSERT_EQ(store.size(), 2);
+    ASSERT_EQ(store.name(0), "r1 comment");
+    ASSERT_EQ(store.id(0), "r1");
+    ASSERT_EQ(store.get(1).str(), "ACGT");
+    for(StringContig contig : io::SeqReader(cache)) {
+        ASSERT_TRUE(contig.compressed);
+    }
+    io::ReadFilter filter;
+    ASSERT_TRUE(io::ReadCacheUpToDate(lib, cache[0], filter));
+    size_t cache_size = std::experimental::filesystem::file_size(cache[0]);
+    std::experimental::filesystem::resize_file(cache[0], cache_size - 3);
+    ASSERT_FALSE(io::ReadCacheUpToDate(lib, cache[0], filter));
+    io::PrepareReadCache(logger, lib, cache[0], 1);
+    ASSERT_EQ(std::experimental::filesystem::file_size(cache[0]), cache_size);
+    std::experimental::filesystem::remove_all(dir);
+    StringContig::homopolymer_compressing = old_compressing;
+}
+
+TEST(ReadIndex, FetchById) {
+    std::experimental::filesystem::path dir = std::experimental::filesystem::temp_directory_path() / "lja_read_index_test";
+    ensure_dir_existance(dir);
+    std::ofstream os(dir / "reads.fastq");
+    os << "@r1 comment\nACGT\nAC\n+\n@@@@\n@@\n@r2\r\nttgg\r\n+r2\r\n@@@@\r\n\n@r3\nA\n+\n@\n";
+    os.close();
+    io::Library lib = {dir / "reads.fastq"};
+    ASSERT_TRUE(io::ReadIndex::Indexable(lib));
+    io::ReadIndex index(lib);
+    io::RandomAccessReader reader(index);
+    ASSERT_EQ(index.size(), 3);
+    StringContig read;
+    ASSERT_TRUE(reader.read("r3", read));
+    ASSERT_EQ(read.seq, "A");
+    ASSERT_TRUE(reader.read("r2", read));
+    ASSERT_EQ(read.seq, "TTGG");
+    ASSERT_TRUE(reader.read("r1", read));
+    ASSERT_EQ(read.comment, "comment");
+    ASSERT_EQ(read.seq, "ACGTAC");
+    ASSERT_FALSE(reader.read("r4", read));
+    std::experimental::filesystem::remove_all(dir);
+}
+
+TEST(SeqReader, MultipleFiles) {
+    std::experimental::filesystem::path dir = std::experimental::filesystem::temp_directory_path() / "lja_multi_file_test";
+    ensure_dir_existance(dir);
+    io::Library lib;
+    for(size_t i = 0; i < 5; i++) {
+        lib.emplace_back(dir / ("reads" + std::to_string(i) + ".fasta"));
+        std::ofstream os(lib.back());
+        for(size_t j = 0; j < i * 3; j++)
+            os << ">r" << i << "_" << j << "\nACGT\n";
+    }
+    std::vector<StringContig> res;
+    for(StringContig contig : io::SeqReader(lib))
+        res.emplace_back(std::move(contig));
+    ASSERT_EQ(res.size(), 30);
+    size_t pos = 0;
+    for(size_t i = 0; i < 5; i++) {
+        for(size_t j = 0; j < i * 3; j++) {
+            ASSERT_EQ(res[pos].id, "r" + std::to_string(i) + "_" + std::to_string(j));
+            pos++;
+        }
+    }
+    std::experimental::filesystem::remove_all(dir);
+}
@@ -0,0 +1,123 @@
+#include "common/rolling_hash.hpp"
+#include "gtest/gtest.h"
+#include <random>
+#include <string>
+
+namespace {
+    Sequence randomSequence(size_t length, size_t seed) {
+        std::mt19937_64 rnd(seed);
+        std::string s(length, 'A');
+        for(char &c : s)
+            c = "ACGT"[rnd() & 3u];
+        return Sequence(s);
+    }
+}
+
+TEST(RollingHash, NarrowHashIsLowBitsOfWideHash) {
+    Sequence seq = randomSequence(500, 239);
+    hashing::RollingHash hasher(31, 239);
+    hashing::BasicRollingHash<hashing::htype64> narrow = hasher.narrow<hashing::htype64>();
+    hashing::KWH kmer(hasher, seq, 0);
+    hashing::BasicKWH<hashing::htype64> narrow_kmer(narrow, seq, 0);
+    while(true) {
+        ASSERT_EQ(narrow_kmer.fHash(), hashing::htype64(kmer.fHash()));
+        ASSERT_EQ(narrow_kmer.rHash(), hashing::htype64(kmer.rHash()));
+        for(unsigned char c = 0; c < 4; c++)
+            ASSERT_EQ(narrow_kmer.extendRight(c),
+                      std::min(hashing::htype64(hasher.extendRight(seq, kmer.pos, kmer.fHash(), c)),
+                               hashing::htype64(hasher.extendLeft(!seq, seq.size() - kmer.pos - 31, kmer.rHash(), c ^ 3u))));
+        if(!kmer.hasNext())
+            break;
+        kmer = kmer.next();
+        narrow_kmer = narrow_kmer.next();
+    }
+}
+
+TEST(RollingHash, MinimizerPositions) {
+    Sequence seq = randomSequence(2000, 17);
+    hashing::BasicRollingHash<hashing::htype64> narrow(21, 239);
+    std::vector<size_t> positions = hashing::BasicMinimizerCalculator<hashing::htype64>(seq, narrow, 50).minimizerPositions();
+    std::vector<hashing::htype64> hashs = hashing::BasicMinimizerCalculator<hashing::htype64>(seq, narrow, 50).minimizerHashs();
+    std::vector<hashing::htype64> position_hashs;
+    for(size_t pos : positions) {
+        hashing::htype64 hash = hashing::BasicKWH<hashing::htype64>(narrow, seq, pos).hash();
+        if(position_hashs.empty() || position_hashs.back() != hash)
+            position_hashs.push_back(hash);
+    }
+    ASSERT_EQ(position_hashs, hashs);
+}
+
+TEST(RollingHash, KmerScannerMatchesKWH) {
+    Sequence seq = randomSequence(10000, 5);
+    hashing::RollingHash hasher(31, 239);
+    for(const Sequence &s : {seq, !seq, seq.Subseq(7, 9000)}) {
+        hashing::BasicKmerScanner<hashing::htype> scanner(hasher, s);
+        std::vector<hashing::BasicHashedKmer<hashing::htype>> kmers;
+        hashing::KWH kwh(hasher, s, 0);
+        size_t cnt = 0;
+        while(scanner.nextBlock(kmers, 1000)) {
+            for(const hashing::BasicHashedKmer<hashing::htype> &kmer : kmers) {
+                ASSERT_EQ(kmer.pos, kwh.pos);
+                ASSERT_EQ(kmer.fhash, kwh.fHash());
+                ASSERT_EQ(kmer.rhash, kwh.rHash());
+                cnt++;
+                if(kwh.hasNext())
+                    kwh = kwh.next();
+            }
+        }
+        ASSERT_EQ(cnt, s.size() - 30);
+    }
+}
+
+TEST(RollingHash, MinimizerSchemes) {
+    Sequence seq = randomSequence(3000, 11);
+    Sequence repeat(std::string(1000, 'A') + seq.Subseq(0, 1000).str() + std::string(1000, 'C'));
+    hashing::RollingHash hasher(21, 239);
+    const size_t w = 30;
+    for(const Sequence &s : {seq, repeat}) {
+        std::vector<hashing::KWH> kmers;
+        for(hashing::KWH kwh(hasher, s, 0);; kwh = kwh.next()) {
+            kmers.emplace_back(kwh);
+            if(!kwh.hasNext())
+                break;
+        }
+        std::vector<hashing::BasicHashedKmer<hashing::htype>> standard;
+        std::vector<hashing::BasicHashedKmer<hashing::htype>> robust;
+        hashing::BasicMinimizerEngine<hashing::htype>(hasher, w).minimizers(s, standard);
+        hashing::BasicMinimizerEngine<hashing::htype>(hasher, w, hashing::MinimizerScheme::Robust).minimizers(s, robust);
+        for(const std::vector<hashing::BasicHashedKmer<hashing::htype>> *selected : {&standard, &robust}) {
+//            Every window of w + 1 consecutive k-mers contains one of its minimal k-mers
+            for(size_t start = 0; start + w < kmers.size(); start++) {
+                hashing::htype min = kmers[start].hash();
+                for(size_t i = start; i <= start + w; i++)
+                    min = std::min(min, kmers[i].hash());
+                ASSERT_TRUE(std::any_of(selected->begin(), selected->end(), [&](const hashing::BasicHashedKmer<hashing::htype> &kmer) {
+                    return kmer.pos >= start && kmer.pos <= start + w && kmer.hash() == min && kmers[kmer.pos].hash() == min;
+                }));
+            }
+        }
+        if(s == repeat)
+            ASSERT_LT(robust.size() * 2, standard.size());
+    }
+}
+
+TEST(RollingHash, Syncmers) {
+    Sequence seq = randomSequence(3000, 13);
+    hashing::RollingHash hasher(31, 239);
+    hashing::RollingHash smer_hasher(11, 239);
+    std::vector<hashing::BasicHashedKmer<hashing::htype>> syncmers;
+    hashing::BasicMinimizerEngine<hashing::htype>(hasher, 10, hashing::MinimizerScheme::Syncmer, 11).minimizers(seq, syncmers);
+    std::vector<size_t> expected;
+    for(size_t pos = 0; pos + 31 <= seq.size(); pos++) {
+        hashing::htype min = hashing::KWH(smer_hasher, seq, pos).hash();
+        for(size_t i = pos; i <= pos + 20; i++)
+            min = std::min(min, hashing::KWH(smer_hasher, seq, i).hash());
+        if(min == hashing::KWH(smer_hasher, seq, pos).hash() || min == hashing::KWH(smer_hasher, seq, pos + 20).hash())
+            expected.push_back(pos);
+    }
+    ASSERT_EQ(syncmers.size(), expected.size());
+    for(size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(syncmers[i].pos, expected[i]);
+        ASSERT_EQ(syncmers[i].hash(), hashing::KWH(hasher, seq, expected[i]).hash());
+    }
+}
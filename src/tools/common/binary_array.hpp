@@ -0,0 +1,135 @@
+#pragma once
+
+#include "mmap_utils.hpp"
+#include "hash_utils.hpp"
+#include "verify.hpp"
+#include <experimental/filesystem>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Binary file with an array of trivially copyable values, e.g. a list of junction hashes or a filled bloom filter table.
+ * Layout: BinaryArrayHeader followed by raw values. The header stores size of a value, number of values, a tag that
+ * identifies parameters the array was computed with and a checksum of the values, so that truncated, corrupted or
+ * stale files are rejected. Files are written under a temporary name and renamed, so an interrupted write never
+ * leaves a file that looks complete. Values start at offset 64 and can be used directly from a MappedArray.
+ */
+struct BinaryArrayHeader {
+    static constexpr uint64_t MAGIC = 0x5941525241414a4cull; // "LJAARRAY"
+    static constexpr uint64_t VERSION = 1;
+    uint64_t magic = MAGIC;
+    uint64_t version = VERSION;
+    uint64_t value_size = 0;
+    uint64_t size = 0;
+    uint64_t tag = 0;
+    uint64_t checksum = 0;
+    uint64_t reserved[2] = {0, 0};
+};
+
+//Four independent lanes keep the checksum at memory speed
+inline uint64_t BinaryChecksum(const char *data, size_t bytes) {
+    uint64_t lanes[4] = {1, 2, 3, 4};
+    size_t words = bytes / 8;
+    size_t i = 0;
+    for(; i + 4 <= words; i += 4) {
+        for(size_t j = 0; j < 4; j++) {
+            uint64_t word;
+            memcpy(&word, data + (i + j) * 8, 8);
+            lanes[j] = hashing::mix64(lanes[j] ^ word);
+        }
+    }
+    uint64_t res = hashing::mix64(lanes[0] ^ hashing::mix64(lanes[1] ^ hashing::mix64(lanes[2] ^ lanes[3])));
+    for(size_t pos = i * 8; pos < bytes; pos++)
+        res = hashing::mix64(res ^ static_cast<unsigned char>(data[pos]));
+    return hashing::mix64(res ^ bytes);
+}
+
+template<class T>
+void WriteBinaryArray(const std::experimental::filesystem::path &path, const T *values, size_t size, uint64_t tag = 0) {
+    static_assert(std::is_trivially_copyable<T>::value, "Values of binary array must be trivially copyable");
+    BinaryArrayHeader header;
+    header.value_size = sizeof(T);
+    header.size = size;
+    header.tag = tag;
+    header.checksum = BinaryChecksum(reinterpret_cast<const char *>(values), size * sizeof(T));
+    std::experimental::filesystem::path tmp = path.string() + ".tmp";
+    std::ofstream os(tmp, std::ios::binary);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char *>(values), size * sizeof(T));
+    os.close();
+    VERIFY_MSG(!os.fail(), "Failed to write " + tmp.string());
+    std::experimental::filesystem::rename(tmp, path);
+}
+
+template<class T>
+void WriteBinaryArray(const std::experimental::filesystem::path &path, const std::vector<T> &values, uint64_t tag = 0) {
+    WriteBinaryArray(path, values.data(), values.size(), tag);
+}
+
+//Checks only the header, so it can be used to tell binary files from files in other formats
+inline bool IsBinaryArray(const std::experimental::filesystem::path &path) {
+    std::ifstream is(path, std::ios::binary);
+    uint64_t magic = 0;
+    is.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    return is && magic == BinaryArrayHeader::MAGIC;
+}
+
+/*
+ * Binary array mapped into memory. valid() is false if the file is missing, was written with another value type or
+ * tag, or does not match its checksum.
+ */
+template<class T>
+class MappedArray {
+private:
+    std::unique_ptr<MappedFile> file;
+    const T *data_ = nullptr;
+    size_t size_ = 0;
+    bool valid_ = false;
+public:
+    MappedArray(const std::experimental::filesystem::path &path, uint64_t tag = 0) {
+        static_assert(std::is_trivially_copyable<T>::value, "Values of binary array must be trivially copyable");
+        if(!std::experimental::filesystem::is_regular_file(path))
+            return;
+        file.reset(new MappedFile(path, true));
+        if(file->size() < sizeof(BinaryArrayHeader))
+            return;
+        const auto *header = reinterpret_cast<const BinaryArrayHeader *>(file->data());
+        if(header->magic != BinaryArrayHeader::MAGIC || header->version != BinaryArrayHeader::VERSION ||
+           header->value_size != sizeof(T) || header->tag != tag ||
+           file->size() != sizeof(BinaryArrayHeader) + header->size * sizeof(T))
+            return;
+        const char *values = file->data() + sizeof(BinaryArrayHeader);
+        if(BinaryChecksum(values, header->size * sizeof(T)) != header->checksum)
+            return;
+        data_ = reinterpret_cast<const T *>(values);
+        size_ = header->size;
+        valid_ = true;
+    }
+
+    MappedArray(const MappedArray &) = delete;
+
+    bool valid() const {
+        return valid_;
+    }
+
+    const T *data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    const T *begin() const {
+        return data_;
+    }
+
+    const T *end() const {
+        return data_ + size_;
+    }
+};
@@ -4,14 +4,18 @@
 
 #pragma once
 #include <algorithm>
-//#include <cmath>
+#include <cstdint>
+#include <cmath>
 //#include <cstddef>
 //#include <cstdlib>
 #include <iterator>
 #include <limits>
 #include <string>
 #include <vector>
+#include "common/hash_utils.hpp"
 #include "common/logging.hpp"
+#include "common/omp_utils.hpp"
+#include "common/verify.hpp"
 
 static const std::size_t bits_per_char = 0x08;    // 8 bits in 1 char(unsigned)
 
@@ -292,6 +296,49 @@ public:
         return true;
     }
 
+//    Looks up n keys at once. Bit positions of a group of keys are computed and prefetched before any of them is
+//    tested, so cache misses of different keys overlap. res[i] is set to 1 if keys[i] may be in the filter.
+    template <typename T>
+    inline void containsBatch(const T* keys, const std::size_t n, unsigned char* res) const
+    {
+        const std::size_t group = 16;
+        const std::size_t max_salt = 8;
+        if (salt_.size() > max_salt)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                res[i] = contains(keys[i]);
+            return;
+        }
+        std::size_t indices[group * max_salt];
+        std::size_t bit = 0;
+        for (std::size_t start = 0; start < n; start += group)
+        {
+            const std::size_t end = std::min(n, start + group);
+            for (std::size_t i = start; i < end; ++i)
+            {
+                for (std::size_t j = 0; j < salt_.size(); ++j)
+                {
+                    std::size_t &bit_index = indices[(i - start) * max_salt + j];
+                    compute_indices(hash_ap(reinterpret_cast<const unsigned char*>(keys + i), sizeof(T), salt_[j]), bit_index, bit);
+                    __builtin_prefetch(&bit_table_[bit_index / bits_per_char]);
+                }
+            }
+            for (std::size_t i = start; i < end; ++i)
+            {
+                res[i] = 1;
+                for (std::size_t j = 0; j < salt_.size(); ++j)
+                {
+                    const std::size_t bit_index = indices[(i - start) * max_salt + j];
+                    if ((bit_table_[bit_index / bits_per_char] & bit_mask[bit_index % bits_per_char]) == 0)
+                    {
+                        res[i] = 0;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
     std::pair<size_t, size_t> count_bits() const {
         logging::TimeSpace t;
         size_t res = 0;
@@ -437,6 +484,13 @@ public:
         return bit_table_.data();
     }
 
+//    Restores a table saved from a filter with the same parameters
+    void assign_table(const cell_type *data, std::size_t size)
+    {
+        VERIFY(size == bit_table_.size());
+        std::copy(data, data + size, bit_table_.begin());
+    }
+
     inline std::size_t hash_count()
     {
         return salt_.size();
@@ -677,3 +731,103 @@ public:
         inserted_element_count_ += b.size();
     }
 };
+
+/*
+ * Bloom filter in which all bits of a key lie in one 64-byte block, so insert and contains touch a single cache line
+ * instead of number_of_hashes random ones. Bits are set with atomic or and the filter can be filled from many threads.
+ * Keys are 64-bit values, e.g. k-mer hashes, and are mixed before use, so they do not need to be uniformly distributed.
+ * With the same size and number of hashes the false positive rate is somewhat higher than in BloomFilter because
+ * blocks are not filled evenly.
+ */
+class BlockedBloomFilter {
+private:
+    static const size_t block_words = 8;
+    static const size_t block_bits = block_words * 64;
+
+    std::vector<uint64_t> storage;
+    uint64_t *data;
+    size_t blocks;
+    size_t number_of_hashes;
+
+    uint64_t *block(uint64_t hash) const {
+        return data + size_t((static_cast<unsigned __int128>(hash) * blocks) >> 64u) * block_words;
+    }
+
+//    Bit positions in the block are taken by 9 bits from the second hash, which is remixed when it runs out of bits
+    template<class F>
+    void forEachBit(uint64_t key, F f) const {
+        uint64_t hash = hashing::mix64(key);
+        uint64_t *b = block(hash);
+        uint64_t bits = hashing::mix64(hash ^ 0x9e3779b97f4a7c15ULL);
+        for(size_t i = 0, used = 0; i < number_of_hashes; i++, used += 9) {
+            if(used + 9 > 64) {
+                bits = hashing::mix64(bits);
+                used = 0;
+            }
+            size_t bit = (bits >> used) & (block_bits - 1);
+            if(!f(b[bit >> 6u], uint64_t(1) << (bit & 63u)))
+                return;
+        }
+    }
+
+public:
+    explicit BlockedBloomFilter(const bloom_parameters &p) :
+            blocks(std::max<size_t>(1, (p.optimal_parameters.table_size + block_bits - 1) / block_bits)),
+            number_of_hashes(p.optimal_parameters.number_of_hashes) {
+        storage.resize(blocks * block_words + block_words, 0);
+        data = storage.data();
+        while(reinterpret_cast<uintptr_t>(data) % 64 != 0)
+            data++;
+    }
+
+    BlockedBloomFilter(const BlockedBloomFilter &) = delete;
+
+    size_t table_size() const {
+        return blocks * block_bits / bits_per_char;
+    }
+
+    const unsigned char *table() const {
+        return reinterpret_cast<const unsigned char *>(data);
+    }
+
+    void assign_table(const unsigned char *saved, size_t size) {
+        VERIFY(size == table_size());
+        std::copy(saved, saved + size, reinterpret_cast<unsigned char *>(data));
+    }
+
+    void insert(uint64_t key) {
+        forEachBit(key, [](uint64_t &word, uint64_t mask) {
+#pragma omp atomic update
+            word |= mask;
+            return true;
+        });
+    }
+
+    bool contains(uint64_t key) const {
+        bool res = true;
+        forEachBit(key, [&res](const uint64_t &word, uint64_t mask) {
+            res = (word & mask) != 0;
+            return res;
+        });
+        return res;
+    }
+
+//    Same as BloomFilter::containsBatch. Only one cache line per key has to be prefetched.
+    void containsBatch(const uint64_t *keys, size_t n, unsigned char *res) const {
+        const size_t group = 16;
+        for(size_t start = 0; start < n; start += group) {
+            const size_t end = std::min(n, start + group);
+            for(size_t i = start; i < end; i++)
+                __builtin_prefetch(block(hashing::mix64(keys[i])));
+            for(size_t i = start; i < end; i++)
+                res[i] = contains(keys[i]);
+        }
+    }
+
+    std::pair<size_t, size_t> count_bits() const {
+        size_t res = 0;
+        for(size_t i = 0; i < blocks * block_words; i++)
+            res += __builtin_popcountll(data[i]);
+        return {res, blocks * block_bits};
+    }
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "verify.hpp"
+#include <experimental/filesystem>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/*
+ * Collects distinct values from many threads in bounded memory. Every thread deduplicates its values in its own
+ * hash set. Once the set passes the thread's share of the memory budget it is sorted and spilled to disk as a run.
+ * collect merges all runs and the remaining sets with a k-way merge and returns the sorted distinct values.
+ * Runs store raw bytes of values, so T must be trivially copyable.
+ */
+template<class T, class Hasher = std::hash<T>>
+class ExternalDistinctCollector {
+private:
+    class RunReader {
+    private:
+        std::ifstream is;
+        std::vector<T> buffer;
+        size_t pos = 0;
+        size_t size = 0;
+    public:
+        explicit RunReader(const std::experimental::filesystem::path &path) : is(path, std::ios::binary),
+                                                                             buffer(4096) {
+            VERIFY_MSG(is.good(), "Failed to open " + path.string());
+        }
+
+        bool next(T &res) {
+            if(pos == size) {
+                is.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(T));
+                size = is.gcount() / sizeof(T);
+                pos = 0;
+                if(size == 0)
+                    return false;
+            }
+            res = buffer[pos++];
+            return true;
+        }
+    };
+
+    std::experimental::filesystem::path dir;
+    std::string prefix;
+    size_t max_set_size;
+    std::vector<std::unordered_set<T, Hasher>> sets;
+    std::vector<std::vector<std::experimental::filesystem::path>> runs;
+
+    void spill(size_t thread) {
+        std::unordered_set<T, Hasher> &set = sets[thread];
+        std::vector<T> values(set.begin(), set.end());
+        set.clear();
+        std::sort(values.begin(), values.end());
+        std::experimental::filesystem::path path =
+                dir / (prefix + "_" + std::to_string(thread) + "_" + std::to_string(runs[thread].size()) + ".run");
+        std::ofstream os(path, std::ios::binary);
+        os.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+        VERIFY_MSG(os.good(), "Failed to write " + path.string());
+        runs[thread].emplace_back(std::move(path));
+    }
+
+public:
+//    Approximate size of a hash set element: the value, node pointer, bucket and allocator overhead
+    static const size_t bytes_per_element = sizeof(T) + 32;
+
+    ExternalDistinctCollector(std::experimental::filesystem::path _dir, std::string _prefix, size_t threads,
+                              size_t memory_budget) :
+            dir(std::move(_dir)), prefix(std::move(_prefix)),
+            max_set_size(std::max<size_t>(1024, memory_budget / threads / bytes_per_element)),
+            sets(threads), runs(threads) {
+    }
+
+    ExternalDistinctCollector(const ExternalDistinctCollector &) = delete;
+
+    ~ExternalDistinctCollector() {
+        for(std::vector<std::experimental::filesystem::path> &thread_runs : runs)
+            for(std::experimental::filesystem::path &path : thread_runs)
+                std::experimental::filesystem::remove(path);
+    }
+
+    void add(size_t thread, const T &value) {
+        sets[thread].insert(value);
+        if(sets[thread].size() >= max_set_size)
+            spill(thread);
+    }
+
+    template<class I>
+    void addAll(size_t thread, I begin, I end) {
+        for(; begin != end; ++begin)
+            add(thread, *begin);
+    }
+
+    size_t runNumber() const {
+        size_t res = 0;
+        for(const std::vector<std::experimental::filesystem::path> &thread_runs : runs)
+            res += thread_runs.size();
+        return res;
+    }
+
+    std::vector<T> collect() {
+        std::vector<T> res;
+        if(runNumber() == 0) {
+            for(std::unordered_set<T, Hasher> &set : sets) {
+                res.insert(res.end(), set.begin(), set.end());
+                set.clear();
+            }
+            std::sort(res.begin(), res.end());
+            res.erase(std::unique(res.begin(), res.end()), res.end());
+            return std::move(res);
+        }
+        for(size_t thread = 0; thread < sets.size(); thread++) {
+            if(!sets[thread].empty())
+                spill(thread);
+        }
+        std::vector<RunReader> readers;
+        for(const std::vector<std::experimental::filesystem::path> &thread_runs : runs)
+            for(const std::experimental::filesystem::path &path : thread_runs)
+                readers.emplace_back(path);
+        typedef std::pair<T, size_t> Item;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+        for(size_t i = 0; i < readers.size(); i++) {
+            T value;
+            if(readers[i].next(value))
+                queue.emplace(value, i);
+        }
+        while(!queue.empty()) {
+            Item item = queue.top();
+            queue.pop();
+            if(res.empty() || res.back() != item.first)
+                res.push_back(item.first);
+            T value;
+            if(readers[item.second].next(value))
+                queue.emplace(value, item.second);
+        }
+        return std::move(res);
+    }
+};
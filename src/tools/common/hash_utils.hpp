@@ -1,9 +1,22 @@
 #pragma once
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
 namespace hashing {
     typedef unsigned __int128 htype;
+//    Narrow hash for k-mers that are never identified by hash alone, see BasicRollingHash
+    typedef uint64_t htype64;
+
+//    Bijective finalizer of MurmurHash3. Spreads weak low bits of polynomial hashes over all bits.
+    inline uint64_t mix64(uint64_t x) {
+        x ^= x >> 33u;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33u;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33u;
+        return x;
+    }
 
     template<class Key>
     struct alt_hasher {
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "verify.hpp"
+#include <experimental/filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+/*
+ * Read-only memory mapping of a whole file. The mapping is shared between processes reading the same file,
+ * so stages running in separate forks use the same page cache.
+ */
+class MappedFile {
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+public:
+    explicit MappedFile(const std::experimental::filesystem::path &path, bool sequential = false) {
+        int fd = open(path.c_str(), O_RDONLY);
+        VERIFY_MSG(fd >= 0, "Could not open file " + path.string());
+        struct stat st{};
+        VERIFY(fstat(fd, &st) == 0);
+        size_ = st.st_size;
+        if(size_ > 0) {
+            void *addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            VERIFY_MSG(addr != MAP_FAILED, "Could not map file " + path.string());
+            data_ = static_cast<const char *>(addr);
+            madvise(addr, size_, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if(data_ != nullptr)
+            munmap(const_cast<char *>(data_), size_);
+    }
+
+    const char *data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+};
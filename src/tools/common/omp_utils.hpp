@@ -3,11 +3,17 @@
 //
 #pragma once
 #include "logging.hpp"
+#include "profiling.hpp"
 #include <parallel/algorithm>
 #include <omp.h>
 #include <utility>
 #include <numeric>
 #include <wait.h>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include "unistd.h"
 
 
@@ -145,6 +151,50 @@ std::ostream& operator<<(std::ostream& out, const ParallelRecordCollector<T>& tr
 }
 
 
+//Queue with limited capacity for passing work between a producer thread and consumers. push blocks while the queue is
+//full, pop blocks while it is empty and returns false once the queue is closed and drained.
+//A consumer may close the queue to stop the producer: push into a closed queue drops the item and returns false.
+template<class T>
+class BoundedQueue {
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+public:
+    explicit BoundedQueue(size_t _capacity) : capacity(_capacity) {
+    }
+
+    bool push(T &&item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if(closed)
+            return false;
+        items.emplace_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this]() { return closed || !items.empty(); });
+        if(items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+};
+
 template<class V>
 class ParallelProcessor {
 public:
@@ -228,6 +278,64 @@ public:
     }
 
 
+//Same contract as processRecords, but records are generated by a dedicated reader thread. It fills batches that are limited
+//by total length of records and passes them through a queue of max_batches batches, so the next batch is read while all
+//threads of the team process the previous one. doBefore and doAfter are called around every batch.
+//The reader is not inside an omp parallel region, so records are parsed serially while the team processes them.
+    template<class I>
+    void processRecordsPipelined(I begin, I end, size_t batch_length = 64 * 1024 * 1024, size_t max_batches = 3) {
+        logging::TimeSpace t;
+        logger.trace() << "Starting pipelined parallel calculation using " << threads << " threads" << std::endl;
+        struct Batch {
+            std::vector<V> items;
+            size_t length = 0;
+        };
+        const size_t buffer_size = 1024 * 1024;
+        BoundedQueue<Batch> queue(max_batches);
+        std::thread reader([&begin, &end, &queue, batch_length, buffer_size]() {
+            while(begin != end) {
+                Batch batch;
+                while(begin != end && batch.length < batch_length && batch.items.size() < buffer_size) {
+                    batch.items.emplace_back(*begin);
+                    ++begin;
+                    batch.length += batch.items.back().size();
+                }
+                queue.push(std::move(batch));
+            }
+            queue.close();
+        });
+        omp_set_num_threads(threads);
+        ParallelProcessor<V> &self = *this;
+        size_t total = 0;
+        size_t total_len = 0;
+        Batch batch;
+        while(queue.pop(batch)) {
+            doBefore();
+            std::vector<V> &items = batch.items;
+#pragma omp parallel default(none) shared(items, self, total)
+            {
+#pragma omp single nowait
+                {
+#pragma omp task default(none) shared(self)
+                    {
+                        self.doInParallel();
+                    }
+                }
+#pragma omp for schedule(dynamic, 16)
+                for(size_t i = 0; i < items.size(); i++)
+                    self.task(total + i, items[i]);
+            }
+            doAfter();
+            logger.trace() << items.size() << " items of total length "<< batch.length << " processed " << std::endl;
+            total += items.size();
+            total_len += batch.length;
+        }
+        reader.join();
+        doInTheEnd();
+        logger.trace() << "Finished parallel processing. Processed " << total <<
+               " items with total length " << total_len << std::endl;
+    }
+
     //This method expects that iterators return references to objects instead of temporary objects.
     template<class I>
     void processObjects(I begin, I end, size_t bucket_size = 1024) {
@@ -295,6 +403,15 @@ void processRecords(I begin, I end, logging::Logger &logger, size_t threads, std
     ParallelProcessor<V>(task, logger, threads).processRecords(begin, end, bucket_length);
 }
 
+//Pipelined version of processRecords. See ParallelProcessor::processRecordsPipelined.
+template<class I>
+void processRecordsPipelined(I begin, I end, logging::Logger &logger, size_t threads,
+                             std::function<void(size_t, typename I::value_type &)> task,
+                             size_t batch_length = 64 * 1024 * 1024) {
+    typedef typename I::value_type V;
+    ParallelProcessor<V>(task, logger, threads).processRecordsPipelined(begin, end, batch_length);
+}
+
 inline void runInFork(const std::function<void()>& f) {
     pid_t p = fork();
     if (p < 0) {
@@ -303,6 +420,7 @@ inline void runInFork(const std::function<void()>& f) {
     }
     if(p == 0) {
         f();
+        profiling::printCounters();
         exit(0);
     } else {
         int status = 0;
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "hash_utils.hpp"
+#include "omp_utils.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Exact set of 64-bit keys, e.g. k-mer hashes, that is filled from many threads and then queried.
+ * Keys are mixed with a bijective function, so the set is exact, and radix partitioned by the top bits of the mixed
+ * value. Every thread appends keys to its own coarse partitions, build sorts and deduplicates partitions in parallel
+ * and stores them as one sorted array with offsets of fine buckets of about bucket_size keys. A lookup reads one
+ * offset and searches a bucket that usually fits in one or two cache lines.
+ * Before build all inserted keys including duplicates are kept in memory, 8 bytes per key.
+ */
+class PartitionedHashSet {
+private:
+    static const size_t coarse_bits = 8;
+    static const size_t bucket_size = 8;
+
+    std::vector<std::vector<std::vector<uint64_t>>> buffers;
+    std::vector<uint64_t> keys;
+    std::vector<size_t> offsets;
+    size_t bucket_bits = coarse_bits;
+
+    size_t bucket(uint64_t mixed) const {
+        return mixed >> (64u - bucket_bits);
+    }
+
+public:
+    explicit PartitionedHashSet(size_t threads) :
+            buffers(threads, std::vector<std::vector<uint64_t>>(size_t(1) << coarse_bits)) {
+    }
+
+    PartitionedHashSet(const PartitionedHashSet &) = delete;
+
+//    Must be called from at most threads OpenMP threads and before build
+    void insert(uint64_t key) {
+        uint64_t mixed = hashing::mix64(key);
+        buffers[omp_get_thread_num()][mixed >> (64u - coarse_bits)].push_back(mixed);
+    }
+
+    void build(size_t threads) {
+        const size_t partitions = size_t(1) << coarse_bits;
+        std::vector<std::vector<uint64_t>> sorted(partitions);
+        omp_set_num_threads(threads);
+#pragma omp parallel for schedule(dynamic, 1)
+        for(size_t p = 0; p < partitions; p++) {
+            std::vector<uint64_t> &part = sorted[p];
+            for(std::vector<std::vector<uint64_t>> &thread_buffers : buffers) {
+                part.insert(part.end(), thread_buffers[p].begin(), thread_buffers[p].end());
+                std::vector<uint64_t>().swap(thread_buffers[p]);
+            }
+            std::sort(part.begin(), part.end());
+            part.erase(std::unique(part.begin(), part.end()), part.end());
+        }
+        buffers.clear();
+        std::vector<size_t> starts(partitions + 1, 0);
+        for(size_t p = 0; p < partitions; p++)
+            starts[p + 1] = starts[p] + sorted[p].size();
+        size_t total = starts[partitions];
+        while(bucket_bits < 48 && (total >> bucket_bits) > bucket_size)
+            bucket_bits++;
+        keys.resize(total);
+        offsets.resize((size_t(1) << bucket_bits) + 1);
+        const size_t shift = bucket_bits - coarse_bits;
+#pragma omp parallel for schedule(dynamic, 1)
+        for(size_t p = 0; p < partitions; p++) {
+            std::copy(sorted[p].begin(), sorted[p].end(), keys.begin() + starts[p]);
+            std::vector<uint64_t>().swap(sorted[p]);
+            size_t pos = starts[p];
+            for(size_t b = p << shift; b < (p + 1) << shift; b++) {
+                while(pos < starts[p + 1] && bucket(keys[pos]) < b)
+                    pos++;
+                offsets[b] = pos;
+            }
+        }
+        offsets.back() = total;
+    }
+
+    bool contains(uint64_t key) const {
+        uint64_t mixed = hashing::mix64(key);
+        size_t b = bucket(mixed);
+        return std::binary_search(keys.begin() + offsets[b], keys.begin() + offsets[b + 1], mixed);
+    }
+
+//    Bucket offsets and then buckets of a group of keys are prefetched before any of them is searched.
+//    res[i] is set to 1 if query[i] is in the set.
+    void containsBatch(const uint64_t *query, size_t n, unsigned char *res) const {
+        const size_t group = 16;
+        size_t buckets[group];
+        for(size_t start = 0; start < n; start += group) {
+            const size_t end = std::min(n, start + group);
+            for(size_t i = start; i < end; i++) {
+                buckets[i - start] = bucket(hashing::mix64(query[i]));
+                __builtin_prefetch(&offsets[buckets[i - start]]);
+            }
+            for(size_t i = start; i < end; i++)
+                __builtin_prefetch(keys.data() + offsets[buckets[i - start]]);
+            for(size_t i = start; i < end; i++)
+                res[i] = contains(query[i]);
+        }
+    }
+
+    size_t size() const {
+        return keys.size();
+    }
+
+    size_t memory() const {
+        return keys.size() * sizeof(uint64_t) + offsets.size() * sizeof(size_t);
+    }
+};
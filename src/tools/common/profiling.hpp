@@ -0,0 +1,134 @@
+#pragma once
+
+#include <time.h>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Instrumentation of hot paths that is compiled in only when LJA_PROFILE_HASHING is defined
+ * (cmake -DPROFILE_HASHING=ON). Otherwise PROFILE_HOT_PATH expands to nothing and instrumented functions cost nothing.
+ * Every thread counts calls in its own cache line sized slot and only every sample_period-th call is timed, so
+ * profiling builds stay usable on full datasets. More than max_threads threads share slots, so slot fields are atomic.
+ * Slots are merged when the statistics are printed. Pipeline stages run in forks, so every forked task prints
+ * counters of its process before exit, see runInFork.
+ */
+namespace profiling {
+#ifdef LJA_PROFILE_HASHING
+    const bool enabled = true;
+#else
+    const bool enabled = false;
+#endif
+
+    class HotPathCounter {
+    public:
+        struct alignas(64) Slot {
+            std::atomic<size_t> calls{0};
+            std::atomic<size_t> sampled_calls{0};
+            std::atomic<size_t> sampled_nanoseconds{0};
+        };
+
+        static const size_t sample_period = 64;
+        static const size_t max_threads = 256;
+
+    private:
+        std::string name;
+        std::vector<Slot> slots;
+
+        static size_t threadSlot() {
+            static std::atomic<size_t> threads{0};
+            thread_local size_t slot = threads++ % max_threads;
+            return slot;
+        }
+
+    public:
+//        All counters of the process, in order of construction
+        static std::vector<const HotPathCounter *> &all() {
+            static std::vector<const HotPathCounter *> counters;
+            return counters;
+        }
+
+        explicit HotPathCounter(std::string _name) : name(std::move(_name)), slots(enabled ? max_threads : 0) {
+            all().push_back(this);
+        }
+
+        HotPathCounter(const HotPathCounter &) = delete;
+
+        Slot &local() {
+            return slots[threadSlot()];
+        }
+
+        size_t calls() const {
+            size_t res = 0;
+            for(const Slot &slot : slots)
+                res += slot.calls.load(std::memory_order_relaxed);
+            return res;
+        }
+
+//        Total time extrapolated from timed calls
+        size_t nanoseconds() const {
+            size_t sampled_calls = 0;
+            size_t sampled_nanoseconds = 0;
+            for(const Slot &slot : slots) {
+                sampled_calls += slot.sampled_calls.load(std::memory_order_relaxed);
+                sampled_nanoseconds += slot.sampled_nanoseconds.load(std::memory_order_relaxed);
+            }
+            return sampled_calls == 0 ? 0 : size_t(double(sampled_nanoseconds) / sampled_calls * calls());
+        }
+
+        std::string str() const {
+            std::stringstream ss;
+            ss << "accumulatedTime_" << name << ": " << nanoseconds() << "\nnumCalls_" << name << ": " << calls();
+            return ss.str();
+        }
+    };
+
+//    Prints merged statistics of all counters that were called in this process
+    inline void printCounters() {
+        if(!enabled)
+            return;
+        std::stringstream ss;
+        for(const HotPathCounter *counter : HotPathCounter::all()) {
+            if(counter->calls() > 0)
+                ss << counter->str() << "\n";
+        }
+        std::cout << ss.str() << std::flush;
+    }
+
+    class ScopedSample {
+    private:
+        HotPathCounter::Slot &slot;
+        bool timed;
+        timespec start{};
+    public:
+        explicit ScopedSample(HotPathCounter &counter) : slot(counter.local()),
+                timed(slot.calls.fetch_add(1, std::memory_order_relaxed) % HotPathCounter::sample_period == 0) {
+            if(timed)
+                clock_gettime(CLOCK_MONOTONIC, &start);
+        }
+
+        ScopedSample(const ScopedSample &) = delete;
+
+        ~ScopedSample() {
+            if(!timed)
+                return;
+            timespec finish{};
+            clock_gettime(CLOCK_MONOTONIC, &finish);
+            slot.sampled_calls.fetch_add(1, std::memory_order_relaxed);
+            slot.sampled_nanoseconds.fetch_add((finish.tv_sec - start.tv_sec) * 1000000000 + finish.tv_nsec - start.tv_nsec,
+                                               std::memory_order_relaxed);
+        }
+    };
+}
+
+#ifdef LJA_PROFILE_HASHING
+#define PROFILE_HOT_PATH_NAME(line) profiling_sample_##line
+#define PROFILE_HOT_PATH_AT(counter, line) profiling::ScopedSample PROFILE_HOT_PATH_NAME(line)(counter)
+#define PROFILE_HOT_PATH(counter) PROFILE_HOT_PATH_AT(counter, __LINE__)
+#else
+#define PROFILE_HOT_PATH(counter)
+#endif
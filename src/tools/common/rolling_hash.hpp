@@ -4,6 +4,7 @@
 //
 
 #include "common/hash_utils.hpp"
+#include "common/profiling.hpp"
 #include "sequences/sequence.hpp"
 #include <deque>
 #include "common/logging.hpp"
@@ -20,57 +21,73 @@ namespace hashing {
             return tmp * tmp;
     }
 
-    class RollingHash {
+    /*
+     * Polynomial rolling hash of k-mers modulo 2^(8 * sizeof(H)). H is htype (128 bits) for hashes that identify
+     * k-mers, e.g. vertex keys. Narrow 64-bit hashes are used where hashes are only compared with each other within
+     * one stage, e.g. to order k-mers when selecting minimizers or as Bloom filter keys. The narrow hash of a k-mer
+     * is equal to the low 64 bits of its wide hash with the same base.
+     */
+    template<class H>
+    class BasicRollingHash {
     private:
         size_t k;
-        htype hbase;
-        htype kpow;
-        htype inv;
+        H hbase;
+        H kpow;
+        H inv;
     public:
 
-        RollingHash(size_t _k, htype _hbase) : k(_k), hbase(_hbase),
+        BasicRollingHash(size_t _k, H _hbase) : k(_k), hbase(_hbase),
                                                kpow(pow(hbase, k - 1)),
-                                               inv(pow(hbase, (htype(1u) << (sizeof(htype) * 8u - 1u)) - 1u)) {
-            VERIFY(inv * hbase == htype(1));
+                                               inv(pow(hbase, (H(1u) << (sizeof(H) * 8u - 1u)) - 1u)) {
+            VERIFY(inv * hbase == H(1));
         }
 
         size_t getK() const {
             return k;
         }
 
-        RollingHash extensionHash() const {
-            return RollingHash(k + 1, hbase);
+        BasicRollingHash extensionHash() const {
+            return BasicRollingHash(k + 1, hbase);
         }
 
-        htype hash(const Sequence &seq, size_t pos) const {
-            htype hash = 0;
+        BasicRollingHash withK(size_t new_k) const {
+            return BasicRollingHash(new_k, hbase);
+        }
+
+        template<class N>
+        BasicRollingHash<N> narrow() const {
+            return BasicRollingHash<N>(k, N(hbase));
+        }
+
+        H hash(const Sequence &seq, size_t pos) const {
+            H hash = 0;
             for (size_t i = pos; i < pos + k; i++) {
                 hash = hash * hbase + seq[i];
             }
             return hash;
         }
 
-        htype extendRight(const Sequence &seq, size_t pos, htype hash, unsigned char c) const {
+        H extendRight(const Sequence &seq, size_t pos, H hash, unsigned char c) const {
             return hash * hbase + c;
         }
 
-        htype extendLeft(const Sequence &seq, size_t pos, htype hash, unsigned char c) const {
+        H extendLeft(const Sequence &seq, size_t pos, H hash, unsigned char c) const {
             return hash + c * kpow * hbase;
         }
 
-        htype shiftRight(const Sequence &seq, size_t pos, htype hash, unsigned char c) const {
+        H shiftRight(const Sequence &seq, size_t pos, H hash, unsigned char c) const {
             return (hash - kpow * seq[pos]) * hbase + c;
         }
 
-        htype shiftLeft(const Sequence &seq, size_t pos, htype hash, unsigned char c) const {
+        H shiftLeft(const Sequence &seq, size_t pos, H hash, unsigned char c) const {
             return (hash - seq[pos + k - 1]) * inv + c * kpow;
         }
 
-        htype next(const Sequence &seq, size_t pos, htype hash) const {
+        H next(const Sequence &seq, size_t pos, H hash) const {
             return shiftRight(seq, pos, hash, seq[pos + k]);
         }
 
-        htype prev(const Sequence &seq, size_t pos, htype hash) const {
+        H prev(const Sequence &seq, size_t pos, H hash) const {
             return shiftLeft(seq, pos, hash, seq[pos - 1]);
         }
 
@@ -81,132 +98,127 @@ namespace hashing {
         bool hasPrev(const Sequence &seq, size_t pos) const {
             return pos > 0;
         }
+
+//        Same as extendRight, extendLeft, shiftRight and shiftLeft but take nucleotide codes instead of positions in a sequence
+        H append(H hash, unsigned char c) const {
+            return hash * hbase + c;
+        }
+
+        H prepend(H hash, unsigned char c) const {
+            return hash + c * kpow * hbase;
+        }
+
+        H roll(H hash, unsigned char out, unsigned char in) const {
+            return (hash - kpow * out) * hbase + in;
+        }
+
+        H rollBack(H hash, unsigned char out, unsigned char in) const {
+            return (hash - out) * inv + in * kpow;
+        }
     };
 
-    class KWH {
+    template<class H>
+    struct BasicHashedKmer {
+        H fhash;
+        H rhash;
+        size_t pos;
+
+        H hash() const {
+            return std::min(fhash, rhash);
+        }
+
+        bool isCanonical() const {
+            return fhash < rhash;
+        }
+    };
+
+    template<class H>
+    class BasicKWH {
     private:
-        KWH(const RollingHash &_hasher, const Sequence &_seq, size_t _pos, htype _fhash, htype _rhash) :
+        BasicKWH(const BasicRollingHash<H> &_hasher, const Sequence &_seq, size_t _pos, H _fhash, H _rhash) :
                 hasher(_hasher), seq(_seq), pos(_pos), fhash(_fhash), rhash(_rhash) {
         }
 
-        htype fhash;
-        htype rhash;
+        H fhash;
+        H rhash;
         Sequence seq; 
     public:
-        const RollingHash &hasher;
+        const BasicRollingHash<H> &hasher;
         size_t pos;
-        inline static size_t accumulatedTime_extendRight = 0;
-        inline static int numCalls_extendRight = 0;
-        inline static size_t accumulatedTime_extendLeft = 0;
-        inline static int numCalls_extendLeft = 0;
-        inline static size_t accumulatedTime_next = 0;
-        inline static int numCalls_next = 0;
-        inline static size_t accumulatedTime_prev = 0;
-        inline static int numCalls_prev = 0;
-        inline static size_t accumulatedTime_hasNext = 0;
-        inline static int numCalls_hasNext = 0;
-        inline static size_t accumulatedTime_hasPrev = 0;
-        inline static int numCalls_hasPrev = 0;
-
-        KWH(const RollingHash &_hasher, const Sequence &_seq, size_t _pos) :
+//        Per call statistics, only collected in builds with PROFILE_HASHING
+        inline static profiling::HotPathCounter profile_extendRight{"extendRight"};
+        inline static profiling::HotPathCounter profile_extendLeft{"extendLeft"};
+        inline static profiling::HotPathCounter profile_next{"next"};
+        inline static profiling::HotPathCounter profile_prev{"prev"};
+        inline static profiling::HotPathCounter profile_hasNext{"hasNext"};
+        inline static profiling::HotPathCounter profile_hasPrev{"hasPrev"};
+
+        BasicKWH(const BasicRollingHash<H> &_hasher, const Sequence &_seq, size_t _pos) :
                 hasher(_hasher), seq(_seq), pos(_pos), fhash(_hasher.hash(_seq, _pos)),
                 rhash(_hasher.hash(!_seq, _seq.size() - _pos - _hasher.getK())) {
         }
 
-        KWH(const KWH &other) = default;
+        BasicKWH(const BasicRollingHash<H> &_hasher, const Sequence &_seq, const BasicHashedKmer<H> &kmer) :
+                BasicKWH(_hasher, _seq, kmer.pos, kmer.fhash, kmer.rhash) {
+        }
+
+        BasicKWH(const BasicKWH &other) = default;
 
         Sequence getSeq() const {
             return seq.Subseq(pos, pos + hasher.getK());
         }
 
-        KWH operator!() const {
-            return KWH(hasher, !seq, seq.size() - pos - hasher.getK(), rhash, fhash);
+        BasicKWH operator!() const {
+            return BasicKWH(hasher, !seq, seq.size() - pos - hasher.getK(), rhash, fhash);
         }
 
-        htype hash() const {
+        H hash() const {
             return std::min(fhash, rhash);
         }
 
-        htype fHash() const {
+        H fHash() const {
             return fhash;
         }
 
-        htype rHash() const {
+        H rHash() const {
             return rhash;
         }
 
-        static void print_times() {
-            std::stringstream ss;
-            ss << "accumulatedTime_extendRight: " << hashing::KWH::accumulatedTime_extendRight
-            << "\nnumCalls_extendRight: " << numCalls_extendRight
-            << "\naccumulatedTime_extendLeft: " << hashing::KWH::accumulatedTime_extendLeft
-            << "\nnumCalls_extendLeft: " << hashing::KWH::numCalls_extendLeft
-            << "\naccumulatedTime_next: " << hashing::KWH::accumulatedTime_next
-            << "\nnumCalls_next: " << hashing::KWH::numCalls_next
-            << "\naccumulatedTime_prev: " << hashing::KWH::accumulatedTime_prev
-            << "\nnumCalls_prev: " << hashing::KWH::numCalls_prev
-            << "\naccumulatedTime_hasNext: " << hashing::KWH::accumulatedTime_hasNext
-            << "\nnumCalls_hasNext: " << hashing::KWH::numCalls_hasNext
-            << "\naccumulatedTime_hasPrev: " << hashing::KWH::accumulatedTime_hasPrev
-            << "\nnumCalls_hasPrev: " << hashing::KWH::numCalls_hasPrev;
-            std::cout << ss.str() << endl;
-        }
-
-        htype extendRight(unsigned char c) const {  // profile this
-            logging::TimeSpace t;
-            htype result = std::min(hasher.extendRight(seq, pos, fhash, c),
+        H extendRight(unsigned char c) const {
+            PROFILE_HOT_PATH(profile_extendRight);
+            return std::min(hasher.extendRight(seq, pos, fhash, c),
                             hasher.extendLeft(!seq, seq.size() - pos - hasher.getK(), rhash, c ^ 3u));
-            accumulatedTime_extendRight += t.get_nanoseconds();
-            numCalls_extendRight++;
-            std::cout << "numCalls_extendRight: " << numCalls_extendRight << std::endl;
-            std::cout << "accumulatedTime_extendRight: " << accumulatedTime_extendRight << std::endl;
-            return result;
         }
 
-        htype extendLeft(unsigned char c) const { // profile this
-            logging::TimeSpace t;
-            htype result = std::min(hasher.extendLeft(seq, pos, fhash, c),
+        H extendLeft(unsigned char c) const {
+            PROFILE_HOT_PATH(profile_extendLeft);
+            return std::min(hasher.extendLeft(seq, pos, fhash, c),
                             hasher.extendRight(!seq, seq.size() - pos - hasher.getK(), rhash, c ^ 3u));
-            accumulatedTime_extendLeft += t.get_nanoseconds();
-            numCalls_extendLeft++;
-            return result;
         }
 
-        KWH next() const { // profile this
-            logging::TimeSpace t;
-            KWH result = {hasher, seq, pos + 1, hasher.next(seq, pos, fhash),
+        BasicKWH next() const {
+            PROFILE_HOT_PATH(profile_next);
+            return {hasher, seq, pos + 1, hasher.next(seq, pos, fhash),
                     hasher.prev(!seq, seq.size() - pos - hasher.getK(), rhash)};
-            accumulatedTime_next += t.get_nanoseconds();
-            numCalls_next++;
-            return result;
         }
 
-        KWH prev() const { // profile this
-            logging::TimeSpace t;
-            KWH result = {hasher, seq, pos - 1, hasher.prev(seq, pos, fhash),
+        BasicKWH prev() const {
+            PROFILE_HOT_PATH(profile_prev);
+            return {hasher, seq, pos - 1, hasher.prev(seq, pos, fhash),
                     hasher.next(!seq, seq.size() - pos - hasher.getK(), rhash)};
-            accumulatedTime_prev += t.get_nanoseconds();
-            numCalls_prev++;
-            return result;
         }
 
-        bool hasNext() const { // profile this
-            logging::TimeSpace t;
-            bool result = hasher.hasNext(seq, pos);
-            accumulatedTime_hasNext += t.get_nanoseconds();
-            numCalls_hasNext++;
-            return result;
+        bool hasNext() const {
+            PROFILE_HOT_PATH(profile_hasNext);
+            return hasher.hasNext(seq, pos);
         }
 
-        bool hasPrev() const { // profile this
-            logging::TimeSpace t;
-            bool result = hasher.hasPrev(seq, pos);
-            accumulatedTime_hasPrev += t.get_nanoseconds();
-            numCalls_hasPrev++;
-            return result;
+        bool hasPrev() const {
+            PROFILE_HOT_PATH(profile_hasPrev);
+            return hasher.hasPrev(seq, pos);
         }
 
-        KWH &operator=(const KWH &other) {
+        BasicKWH &operator=(const BasicKWH &other) {
             if (this == &other)
                 return *this;
             seq = other.seq;
@@ -222,90 +234,282 @@ namespace hashing {
     };
 
 
-    class MinQueue {
-        std::deque<KWH> q;
+    /*
+     * Computes hashes of consecutive k-mers of a sequence as flat (fhash, rhash, pos) records.
+     * The sequence is unpacked once and both strands are updated in the same loop, so unlike iterating with
+     * KWH::next no objects or Sequence copies are created per k-mer. Long sequences can be processed block by block.
+     */
+    template<class H>
+    class BasicKmerScanner {
+    private:
+        BasicRollingHash<H> hasher;
+        std::vector<uint64_t> words;
+        size_t size;
+        size_t next_pos = 0;
+        H fhash = 0;
+        H rhash = 0;
+
+        unsigned char code(size_t i) const {
+            return (words[i >> 5u] >> ((i & 31u) << 1u)) & 3u;
+        }
+
     public:
-        MinQueue() = default;
+        static const size_t default_block_size = 4096;
 
-        void push(const KWH &kwh) {
-            while (!q.empty() && q.back().hash() > kwh.hash()) {
-                q.pop_back();
-            }
-            q.push_back(kwh);
+        explicit BasicKmerScanner(const BasicRollingHash<H> &_hasher) : hasher(_hasher), size(0) {
+        }
+
+        BasicKmerScanner(const BasicRollingHash<H> &_hasher, const Sequence &seq) : BasicKmerScanner(_hasher) {
+            reset(seq);
+        }
+
+        const BasicRollingHash<H> &getHasher() const {
+            return hasher;
         }
 
-        void pop(size_t pos) {
-            if (!q.empty() && q.front().pos < pos) {
-                q.pop_front();
+//        Starts scanning a new sequence. Buffers are reused, so one scanner can process many reads without allocations.
+        void reset(const Sequence &seq) {
+            size = seq.size();
+            next_pos = 0;
+            fhash = 0;
+            rhash = 0;
+            words.resize(packing::Words(size));
+            seq.copyPacked(words.data());
+            size_t k = hasher.getK();
+            if(size < k)
+                return;
+            for(size_t i = 0; i < k; i++) {
+                fhash = hasher.append(fhash, code(i));
+                rhash = hasher.append(rhash, 3u - code(k - 1 - i));
             }
         }
 
         bool empty() const {
-            return q.empty();
+            return next_pos + hasher.getK() > size;
+        }
+
+//        Replaces contents of res with at most max_kmers next k-mers. Returns false if there are no k-mers left.
+        bool nextBlock(std::vector<BasicHashedKmer<H>> &res, size_t max_kmers = default_block_size) {
+            res.clear();
+            if(empty())
+                return false;
+            size_t k = hasher.getK();
+            size_t end = std::min(size - k + 1, next_pos + max_kmers);
+            res.resize(end - next_pos);
+            BasicHashedKmer<H> *out = res.data();
+            H f = fhash;
+            H r = rhash;
+            for(size_t pos = next_pos; pos < end; pos++) {
+                *(out++) = {f, r, pos};
+                if(pos + k < size) {
+                    unsigned char c_out = code(pos);
+                    unsigned char c_in = code(pos + k);
+                    f = hasher.roll(f, c_out, c_in);
+                    r = hasher.rollBack(r, 3u - c_out, 3u - c_in);
+                }
+            }
+            fhash = f;
+            rhash = r;
+            next_pos = end;
+            return true;
         }
 
-        KWH get() const {
-            return q.front();
+        void hashAll(std::vector<BasicHashedKmer<H>> &res) {
+            nextBlock(res, size_t(-1));
         }
+    };
 
-        size_t size() const {
-            return q.size();
-        }
+    enum class MinimizerScheme {
+        Standard, Robust, Syncmer
     };
 
-    class MinimizerCalculator {
+//    Monotonic queue of k-mers in a ring buffer that is allocated once for the longest window
+    template<class H>
+    class BasicMinQueue {
     private:
-        const Sequence seq;
-        const size_t w;
-        KWH kwh;
-        size_t pos;
-        MinQueue queue;
+        std::vector<BasicHashedKmer<H>> ring;
+        size_t head = 0;
+        size_t count = 0;
+
+        size_t index(size_t i) const {
+            i += head;
+            return i < ring.size() ? i : i - ring.size();
+        }
+
     public:
-        MinimizerCalculator(const Sequence &_seq, const RollingHash &_hasher, size_t _w) :
-                seq(_seq), w(_w), kwh(_hasher, seq, 0), pos(-1) {
-            VERIFY(w >= 2); //This code does not work for w = 1
-            VERIFY(seq.size() >= _hasher.getK() + w - 1)
-            queue.push(kwh);
-            for (size_t i = 1; i < w; i++) {
-                kwh = kwh.next();
-                queue.push(kwh);
+        explicit BasicMinQueue(size_t capacity) : ring(capacity) {
+        }
+
+        void clear() {
+            head = 0;
+            count = 0;
+        }
+
+//        Equal hashes are resolved to the leftmost k-mer, or to the rightmost one if rightmost is set
+        void push(const BasicHashedKmer<H> &kmer, bool rightmost) {
+            H hash = kmer.hash();
+            while (count > 0) {
+                H back = ring[index(count - 1)].hash();
+                if (back < hash || (back == hash && !rightmost))
+                    break;
+                count--;
             }
+            ring[index(count)] = kmer;
+            count++;
         }
 
-        KWH next() {
-            pos += 1;
-            queue.pop(pos);
-            kwh = kwh.next();
-            queue.push(kwh);
-            return queue.get();
+        void popBefore(size_t pos) {
+            while (count > 0 && ring[head].pos < pos) {
+                head = index(1);
+                count--;
+            }
         }
 
-        bool hasNext() const {
-            return kwh.hasNext();
+        bool empty() const {
+            return count == 0;
         }
 
-        std::vector<htype> minimizerHashs() {
-            std::vector<htype> res;
-            res.push_back(queue.get().hash());
-            while (hasNext()) {
-                htype val = next().hash();
-                if (val != res.back()) {
-                    res.push_back(val);
+        const BasicHashedKmer<H> &get() const {
+            return ring[head];
+        }
+    };
+
+    /*
+     * Selects minimizers of sequences. The first window consists of k-mers [0, w - 1] and every next window [i, i + w]
+     * is shifted by one, a k-mer is reported once even if it is the minimizer of many consecutive windows.
+     * Standard scheme resolves equal hashes to the leftmost k-mer. Robust winnowing resolves them to the rightmost
+     * k-mer, but keeps the previous minimizer while it stays in the window, so low complexity regions with many
+     * equal hashes do not produce a minimizer per position. Syncmer scheme selects closed syncmers: k-mers whose
+     * smallest s-mer is the first or the last one. Syncmers do not depend on the neighbouring k-mers, but their
+     * density can not be lower than 2 / (k - s + 1) and they do not guarantee a k-mer in every window.
+     * One engine is meant to be used by one thread and reuses its buffers for all sequences.
+     */
+    template<class H>
+    class BasicMinimizerEngine {
+    private:
+        size_t w;
+        MinimizerScheme scheme;
+        BasicKmerScanner<H> scanner;
+        BasicKmerScanner<H> smer_scanner;
+        BasicMinQueue<H> queue;
+        std::vector<H> recent_smers;
+        std::vector<BasicHashedKmer<H>> block;
+        std::vector<BasicHashedKmer<H>> smer_block;
+
+        void selectWindowMinimizers(std::vector<BasicHashedKmer<H>> &res) {
+            const bool robust = scheme == MinimizerScheme::Robust;
+            queue.clear();
+            BasicHashedKmer<H> selected{0, 0, size_t(-1)};
+            while (scanner.nextBlock(block)) {
+                for (const BasicHashedKmer<H> &kmer : block) {
+                    size_t i = kmer.pos;
+                    if (i > w)
+                        queue.popBefore(i - w);
+                    queue.push(kmer, robust);
+                    if (i + 1 < w)
+                        continue;
+                    const BasicHashedKmer<H> &min = queue.get();
+                    if (min.pos == selected.pos)
+                        continue;
+                    if (robust && selected.pos != size_t(-1) && selected.pos + w >= i && selected.hash() == min.hash())
+                        continue;
+                    selected = min;
+                    res.push_back(selected);
                 }
             }
-            return std::move(res);
         }
 
-        std::vector<KWH> minimizers() {
-            std::vector<KWH> res;
-            res.push_back(next());
-            while (hasNext()) {
-                KWH val = next();
-                if (val.pos != res.back().pos) {
-                    res.push_back(val);
+        void selectSyncmers(const Sequence &seq, std::vector<BasicHashedKmer<H>> &res) {
+            const size_t span = recent_smers.size() - 1;
+            smer_scanner.reset(seq);
+            queue.clear();
+            size_t next_smer = 0;
+            size_t smer_index = 0;
+            smer_block.clear();
+            while (scanner.nextBlock(block)) {
+                for (const BasicHashedKmer<H> &kmer : block) {
+                    while (next_smer <= kmer.pos + span) {
+                        if (smer_index == smer_block.size()) {
+                            smer_scanner.nextBlock(smer_block);
+                            smer_index = 0;
+                        }
+                        const BasicHashedKmer<H> &smer = smer_block[smer_index++];
+                        recent_smers[smer.pos % (span + 1)] = smer.hash();
+                        if (smer.pos > span)
+                            queue.popBefore(smer.pos - span);
+                        queue.push(smer, false);
+                        next_smer++;
+                    }
+                    H min = queue.get().hash();
+                    if (min == recent_smers[kmer.pos % (span + 1)] || min == recent_smers[(kmer.pos + span) % (span + 1)])
+                        res.push_back(kmer);
                 }
             }
+        }
+
+    public:
+//        Closed syncmers with s = k - w have the same expected density as window minimizers. Shorter s-mers
+//        have too many equal hashes, so for windows longer than k - 15 syncmers are denser than minimizers.
+        static size_t DefaultSyncmerLength(size_t k, size_t w) {
+            return k > w + 15 ? k - w : std::min<size_t>(k, 15);
+        }
+
+        BasicMinimizerEngine(const BasicRollingHash<H> &hasher, size_t _w,
+                             MinimizerScheme _scheme = MinimizerScheme::Standard, size_t syncmer_length = 0) :
+                w(_w), scheme(_scheme), scanner(hasher),
+                smer_scanner(hasher.withK(syncmer_length == 0 ? DefaultSyncmerLength(hasher.getK(), _w) : syncmer_length)),
+                queue(_scheme == MinimizerScheme::Syncmer ? hasher.getK() - smer_scanner.getHasher().getK() + 1 : _w + 1) {
+            VERIFY(w >= 2); //This code does not work for w = 1
+            VERIFY(smer_scanner.getHasher().getK() <= hasher.getK());
+            if (scheme == MinimizerScheme::Syncmer)
+                recent_smers.resize(hasher.getK() - smer_scanner.getHasher().getK() + 1);
+        }
+
+        size_t getK() const {
+            return scanner.getHasher().getK();
+        }
+
+//        Appends minimizers of seq to res in the order of their positions
+        void minimizers(const Sequence &seq, std::vector<BasicHashedKmer<H>> &res) {
+            scanner.reset(seq);
+            if (scheme == MinimizerScheme::Syncmer)
+                selectSyncmers(seq, res);
+            else
+                selectWindowMinimizers(res);
+        }
+    };
+
+    template<class H>
+    class BasicMinimizerCalculator {
+    private:
+        const Sequence seq;
+        BasicMinimizerEngine<H> engine;
+        std::vector<BasicHashedKmer<H>> selected;
+    public:
+        BasicMinimizerCalculator(const Sequence &_seq, const BasicRollingHash<H> &_hasher, size_t _w) :
+                seq(_seq), engine(_hasher, _w) {
+            VERIFY(seq.size() >= _hasher.getK() + _w - 1)
+            engine.minimizers(seq, selected);
+        }
+
+        std::vector<H> minimizerHashs() const {
+            std::vector<H> res;
+            for (const BasicHashedKmer<H> &kmer : selected) {
+                if (res.empty() || kmer.hash() != res.back())
+                    res.push_back(kmer.hash());
+            }
+            return std::move(res);
+        }
+
+        std::vector<size_t> minimizerPositions() const {
+            std::vector<size_t> res;
+            for (const BasicHashedKmer<H> &kmer : selected)
+                res.push_back(kmer.pos);
             return std::move(res);
         }
     };
-}
\ No newline at end of file
+
+    typedef BasicRollingHash<htype> RollingHash;
+    typedef BasicKWH<htype> KWH;
+    typedef BasicMinimizerCalculator<htype> MinimizerCalculator;
+}
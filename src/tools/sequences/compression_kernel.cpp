@@ -0,0 +1,225 @@
+#include "compression_kernel.hpp"
+#include "nucl.hpp"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace hpc {
+    namespace {
+        struct CodeTable {
+            uint8_t codes[256];
+
+            CodeTable() : codes() {
+                for(size_t c = 0; c < 256; c++) {
+                    char code = dignucl(char(c));
+                    codes[c] = code == INVALID_NUCL ? 0 : uint8_t(code);
+                }
+            }
+
+            uint64_t operator[](char c) const {
+                return codes[uint8_t(c)];
+            }
+        };
+
+        const CodeTable code_table;
+
+        class CharSink {
+        private:
+            char *out;
+        public:
+            explicit CharSink(char *out) : out(out) {
+            }
+
+            void set(size_t pos, char c) {
+                out[pos] = c;
+            }
+
+            void finish(size_t) {
+            }
+        };
+
+//        Accumulates the current word in a register. Positions may go back when a long dimer run is shortened.
+        class WordSink {
+        private:
+            uint64_t *words;
+            size_t word = 0;
+            uint64_t acc = 0;
+        public:
+            explicit WordSink(uint64_t *words) : words(words) {
+            }
+
+            void set(size_t pos, char c) {
+                if((pos >> 5u) != word) {
+                    words[word] = acc;
+                    acc = (pos >> 5u) < word ? words[pos >> 5u] : 0;
+                    word = pos >> 5u;
+                }
+                size_t shift = (pos & 31u) << 1u;
+                acc = (acc & ~(uint64_t(3) << shift)) | (code_table[c] << shift);
+            }
+
+            void finish(size_t size) {
+                words[word] = acc;
+                if((size & 31u) != 0)
+                    words[size >> 5u] &= (uint64_t(1) << ((size & 31u) << 1u)) - 1;
+            }
+        };
+
+//        Receives homopolymer runs in order and applies dimer compression to them.
+//        A dimer run is only ever shortened by an even number of characters, so the last two written characters
+//        never change when the output position goes back and are kept in registers.
+        template<class Sink, bool Dimers>
+        class RunConsumer {
+        private:
+            Sink sink;
+            uint32_t *run_lengths;
+            size_t min_dimer_to_compress;
+            size_t max_dimer_size;
+            size_t cur = 0;
+            size_t at_len = 2;
+            char last = 0;
+            char before_last = 0;
+
+            void write(char c, size_t len) {
+                sink.set(cur, c);
+                if(run_lengths != nullptr)
+                    run_lengths[cur] = uint32_t(len);
+                cur++;
+                before_last = last;
+                last = c;
+            }
+
+            void finishDimer() {
+                if(at_len > min_dimer_to_compress && at_len > max_dimer_size)
+                    cur -= (at_len - max_dimer_size) / 2 * 2;
+            }
+
+        public:
+            RunConsumer(Sink sink, uint32_t *run_lengths, size_t min_dimer_to_compress, size_t max_dimer_size) :
+                    sink(sink), run_lengths(run_lengths), min_dimer_to_compress(min_dimer_to_compress),
+                    max_dimer_size(max_dimer_size) {
+            }
+
+            void push(char c, size_t len) {
+                if(Dimers && cur >= 2) {
+                    if(c == before_last) {
+                        at_len++;
+                    } else {
+                        finishDimer();
+                        at_len = 2;
+                    }
+                }
+                write(c, len);
+            }
+
+            size_t finish() {
+                if(Dimers && cur >= 2)
+                    finishDimer();
+                sink.finish(cur);
+                return cur;
+            }
+        };
+
+        template<class Consumer>
+        class RunSplitter {
+        private:
+            const char *s;
+            size_t start = 0;
+            Consumer &consumer;
+        public:
+            RunSplitter(const char *s, Consumer &consumer) : s(s), consumer(consumer) {
+            }
+
+//            New run starts at position pos. Writes to the output never go past start, so compression can be in place.
+            void boundary(size_t pos) {
+                consumer.push(s[start], pos - start);
+                start = pos;
+            }
+        };
+
+        template<class Splitter>
+        void ScanScalar(const char *s, size_t from, size_t n, Splitter &splitter) {
+            for(size_t i = from; i < n; i++) {
+                if(s[i] != s[i - 1])
+                    splitter.boundary(i);
+            }
+        }
+
+#if defined(__x86_64__)
+        template<class Splitter>
+        __attribute__((target("avx2")))
+        void ScanAVX2(const char *s, size_t n, Splitter &splitter) {
+            size_t i = 1;
+            for(; i + 32 <= n; i += 32) {
+                __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+                __m256i prev = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i - 1));
+                uint32_t mask = ~uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, prev)));
+                while(mask != 0) {
+                    splitter.boundary(i + __builtin_ctz(mask));
+                    mask &= mask - 1;
+                }
+            }
+            ScanScalar(s, i, n, splitter);
+        }
+
+        template<class Splitter>
+        void ScanSSE2(const char *s, size_t n, Splitter &splitter) {
+            size_t i = 1;
+            for(; i + 16 <= n; i += 16) {
+                __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+                __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i - 1));
+                uint32_t mask = ~uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(cur, prev))) & 0xffffu;
+                while(mask != 0) {
+                    splitter.boundary(i + __builtin_ctz(mask));
+                    mask &= mask - 1;
+                }
+            }
+            ScanScalar(s, i, n, splitter);
+        }
+
+        bool HasAVX2() {
+            static const bool res = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+            return res;
+        }
+#endif
+
+        template<class Sink, bool Dimers>
+        size_t CompressRuns(const char *s, size_t n, size_t min_dimer_to_compress, size_t max_dimer_size, Sink sink,
+                            uint32_t *run_lengths) {
+            if(n == 0)
+                return 0;
+            RunConsumer<Sink, Dimers> consumer(sink, run_lengths, min_dimer_to_compress, max_dimer_size);
+            RunSplitter<RunConsumer<Sink, Dimers>> splitter(s, consumer);
+#if defined(__x86_64__)
+            if(HasAVX2())
+                ScanAVX2(s, n, splitter);
+            else
+                ScanSSE2(s, n, splitter);
+#else
+            ScanScalar(s, 1, n, splitter);
+#endif
+            splitter.boundary(n);
+            return consumer.finish();
+        }
+
+//        Dimer runs can not be longer than the sequence, so short sequences skip the dimer state machine
+        template<class Sink>
+        size_t Compress(const char *s, size_t n, size_t min_dimer_to_compress, size_t max_dimer_size, Sink sink,
+                        uint32_t *run_lengths) {
+            if(min_dimer_to_compress >= n)
+                return CompressRuns<Sink, false>(s, n, min_dimer_to_compress, max_dimer_size, sink, run_lengths);
+            else
+                return CompressRuns<Sink, true>(s, n, min_dimer_to_compress, max_dimer_size, sink, run_lengths);
+        }
+    }
+
+    size_t CompressToChars(const char *s, size_t n, size_t min_dimer_to_compress, size_t max_dimer_size,
+                           char *out, uint32_t *run_lengths) {
+        return Compress(s, n, min_dimer_to_compress, max_dimer_size, CharSink(out), run_lengths);
+    }
+
+    size_t CompressToWords(const char *s, size_t n, size_t min_dimer_to_compress, size_t max_dimer_size,
+                           uint64_t *words, uint32_t *run_lengths) {
+        return Compress(s, n, min_dimer_to_compress, max_dimer_size, WordSink(words), run_lengths);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Homopolymer and dimer compression of nucleotide strings in a single pass over the input.
+ * Run boundaries are found with vector comparisons (AVX2 or SSE2, selected at runtime, with a scalar fallback on other
+ * architectures). Every homopolymer run is then passed to the dimer compression that works exactly like
+ * StringContig::compress used to, and written to the output either as characters or 2-bit packed in Sequence layout.
+ * If run_lengths is not null it receives for every output character the length of the homopolymer run of the input
+ * that this character represents.
+ */
+namespace hpc {
+    // Pass as min_dimer_to_compress and max_dimer_size to only compress homopolymers
+    const size_t NO_DIMER_COMPRESSION = size_t(-1);
+
+    inline size_t PackedWords(size_t length) {
+        return (length + 31) / 32;
+    }
+
+    // out may point to s. Returns length of the compressed string.
+    size_t CompressToChars(const char *s, size_t n, size_t min_dimer_to_compress, size_t max_dimer_size,
+                           char *out, uint32_t *run_lengths = nullptr);
+
+    // words must have space for PackedWords(n) words. Returns length of the compressed sequence.
+    size_t CompressToWords(const char *s, size_t n, size_t min_dimer_to_compress, size_t max_dimer_size,
+                           uint64_t *words, uint32_t *run_lengths = nullptr);
+}
@@ -3,6 +3,8 @@
 //
 
 #include "contigs.hpp"
+#include "compression_kernel.hpp"
+#include "packing_kernel.hpp"
 
 bool StringContig::homopolymer_compressing = false;
 size_t StringContig::min_dimer_to_compress = 1000000000;
@@ -10,38 +12,31 @@ size_t StringContig::max_dimer_size = 1000000000;
 size_t StringContig::dimer_step = 1;
 
 void StringContig::compress() {
-    if(!homopolymer_compressing)
+    if(!homopolymer_compressing || compressed)
         return;
-    seq.erase(std::unique(seq.begin(), seq.end()), seq.end());
+    compressed = true;
     VERIFY(min_dimer_to_compress <= max_dimer_size);
     VERIFY(min_dimer_to_compress >= 4);
     VERIFY(dimer_step == 1);
-    if(min_dimer_to_compress >= seq.size())
-        return;
-    size_t cur = 2;
-    size_t at_len = 2;
-    for(size_t i = 2; i <= seq.size(); i++) {
-        if (i < seq.size() && seq[i] == seq[cur - 2]) {
-            seq[cur] = seq[i];
-            cur++;
-            at_len += 1;
-        } else {
-            if(at_len > min_dimer_to_compress) {
-                if(at_len > max_dimer_size) {
-                    cur -= (at_len - max_dimer_size) / 2 * 2;
-                    at_len -= (at_len - max_dimer_size) / 2 * 2;
-                }
-                size_t corr_at_len = at_len / dimer_step * dimer_step;
-                VERIFY(corr_at_len == at_len);
-                cur -= (at_len - corr_at_len) / 2 * 2;
-                at_len -= (at_len - corr_at_len) / 2 * 2;
-            }
-            at_len = 2;
-            if(i < seq.size()) {
-                seq[cur] = seq[i];
-                cur++;
-            }
-        }
+    seq.resize(hpc::CompressToChars(&seq[0], seq.size(), min_dimer_to_compress, max_dimer_size, &seq[0]));
+}
+
+size_t StringContig::compressPacked(std::vector<uint64_t> &words) const {
+    words.resize(hpc::PackedWords(seq.size()));
+    if(!homopolymer_compressing || compressed) {
+        packing::Pack(seq.data(), seq.size(), words.data());
+        return seq.size();
     }
-    seq.erase(seq.begin() + cur, seq.end());
+    VERIFY(min_dimer_to_compress <= max_dimer_size);
+    VERIFY(min_dimer_to_compress >= 4);
+    VERIFY(dimer_step == 1);
+    return hpc::CompressToWords(seq.data(), seq.size(), min_dimer_to_compress, max_dimer_size, words.data());
+}
+
+Sequence StringContig::makeSequence() {
+    if(!homopolymer_compressing || compressed)
+        return Sequence(seq);
+    thread_local std::vector<uint64_t> words;
+    size_t size = compressPacked(words);
+    return Sequence::FromPacked(words.data(), size);
 }
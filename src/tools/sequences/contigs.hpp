@@ -262,6 +262,8 @@ public:
     std::string id;
     std::string comment;
     std::string seq;
+//    Set for sequences that were already compressed, e.g. ones loaded from read cache
+    bool compressed = false;
     static bool homopolymer_compressing;
     static size_t min_dimer_to_compress;
     static size_t max_dimer_size;
@@ -288,6 +290,9 @@ public:
 
     void compress();
 
+//    Compresses (if needed) directly into 2-bit packed words in Sequence layout without changing seq. Returns length.
+    size_t compressPacked(std::vector<uint64_t> &words) const;
+
 //    void atCompress() {
 //        size_t cur = 0;
 //        size_t at_len = 0;
@@ -304,8 +309,7 @@ public:
 //    }
 
     Contig makeContig() {
-        compress();
-        return Contig(Sequence(seq), id);
+        return Contig(makeSequence(), id);
     }
 
 //    Contig makeCompressedContig() {
@@ -313,10 +317,7 @@ public:
 //        return makeContig();
 //    }
 
-    Sequence makeSequence() {
-        compress();
-        return Sequence(seq);
-    }
+    Sequence makeSequence();
 
 //    Sequence makeCompressedSequence() {
 //        compress();
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "contigs.hpp"
+#include "read_filter.hpp"
+#include <omp.h>
+#include <cctype>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace io {
+    class RecordSource {
+    public:
+//        Moves next record into res. Returns false if there are no more records.
+        virtual bool next(StringContig &res) = 0;
+
+        virtual ~RecordSource() = default;
+    };
+
+    /*
+     * Parser for FASTA and FASTQ streams that reads input in large blocks instead of line by line.
+     * Record boundaries inside a block are found with memchr and then all complete records of the block are
+     * converted to StringContig. Incomplete record at the end of a block is moved to the start of the
+     * buffer and finished after the next block is read.
+     * If called from inside a parallel region (e.g. from the single producer thread of processRecords) records are
+     * built with omp tasks so that idle worker threads can take part in parsing. Outside of a parallel region records
+     * are built serially: parser must not start an omp thread team by itself, e.g. in the parent process of forked
+     * pipeline stages. Reader threads of processRecordsPipelined (used by constructMinimizers and RecordStorage::fill)
+     * and decoder threads of MultiFileSource are std::threads, so there records are always built serially and
+     * reading overlaps with processing instead.
+     * If a ReadFilter is given, quality lines of FASTQ records are passed to it and dropped records are skipped.
+     */
+    class FastxParser : public RecordSource {
+    private:
+        struct RecordSpan {
+            size_t header_begin;
+            size_t header_end;
+            size_t seq_begin;
+            size_t seq_end;
+            size_t qual_begin;
+            size_t qual_end;
+        };
+
+        enum class ParseResult {
+            Complete, Incomplete, End
+        };
+
+        std::istream &stream;
+        bool fastq;
+        size_t block_size;
+        ReadFilter *filter;
+        std::vector<char> buffer;
+        size_t data_start = 0;
+        size_t data_end = 0;
+        bool stream_eof = false;
+        std::vector<RecordSpan> spans;
+        std::vector<StringContig> parsed;
+        size_t parsed_pos = 0;
+
+        static bool isSpace(char c) {
+            return std::isspace(static_cast<unsigned char>(c));
+        }
+
+        void trimSpan(size_t &from, size_t &to) const {
+            while(from < to && isSpace(buffer[from]))
+                from++;
+            while(to > from && isSpace(buffer[to - 1]))
+                to--;
+        }
+
+        size_t trimmedLength(size_t from, size_t to) const {
+            trimSpan(from, to);
+            return to - from;
+        }
+
+//        Finds line starting at pos. Returns false if the line is not fully loaded yet or if there are no more lines.
+        bool nextLine(size_t pos, size_t &line_end, size_t &next_pos) const {
+            if(pos >= data_end)
+                return false;
+            const char *found = static_cast<const char *>(memchr(buffer.data() + pos, '\n', data_end - pos));
+            if(found != nullptr) {
+                line_end = found - buffer.data();
+                next_pos = line_end + 1;
+                return true;
+            }
+            if(!stream_eof)
+                return false;
+            line_end = data_end;
+            next_pos = data_end;
+            return true;
+        }
+
+        ParseResult notEnoughData(size_t pos) const {
+            return (stream_eof && pos >= data_end) ? ParseResult::End : ParseResult::Incomplete;
+        }
+
+        ParseResult parseRecord(size_t pos, RecordSpan &rec, size_t &next) const {
+            size_t line_end, next_pos;
+            while(true) {
+                if(!nextLine(pos, line_end, next_pos))
+                    return notEnoughData(pos);
+                rec.header_begin = pos + 1;
+                rec.header_end = line_end;
+                pos = next_pos;
+                if(rec.header_begin <= rec.header_end && trimmedLength(rec.header_begin - 1, rec.header_end) > 0)
+                    break;
+            }
+            trimSpan(rec.header_begin, rec.header_end);
+            if(!nextLine(pos, line_end, next_pos))
+                return stream_eof ? ParseResult::End : ParseResult::Incomplete;
+            rec.seq_begin = pos;
+            size_t seq_len = trimmedLength(pos, line_end);
+            pos = next_pos;
+            if(seq_len == 0) {
+                next = pos;
+                rec.seq_end = rec.seq_begin;
+                return ParseResult::Complete;
+            }
+            while(true) {
+                if(pos >= data_end) {
+                    if(!stream_eof)
+                        return ParseResult::Incomplete;
+                    break;
+                }
+                if(buffer[pos] == '>' || buffer[pos] == '+')
+                    break;
+                if(!nextLine(pos, line_end, next_pos))
+                    return ParseResult::Incomplete;
+                size_t len = trimmedLength(pos, line_end);
+                pos = next_pos;
+                if(len == 0)
+                    break;
+                seq_len += len;
+            }
+            rec.seq_end = pos;
+            if(fastq) {
+                if(!nextLine(pos, line_end, next_pos)) {
+                    if(!stream_eof)
+                        return ParseResult::Incomplete;
+                } else {
+                    pos = next_pos;
+                }
+                rec.qual_begin = pos;
+                size_t qlen = 0;
+                while(qlen < seq_len) {
+                    if(!nextLine(pos, line_end, next_pos)) {
+                        if(!stream_eof)
+                            return ParseResult::Incomplete;
+                        break;
+                    }
+                    size_t len = trimmedLength(pos, line_end);
+                    pos = next_pos;
+                    if(len == 0)
+                        break;
+                    qlen += len;
+                }
+                rec.qual_end = pos;
+            }
+            next = pos;
+            return ParseResult::Complete;
+        }
+
+        void readBlock() {
+            if(data_start > 0) {
+                memmove(buffer.data(), buffer.data() + data_start, data_end - data_start);
+                data_end -= data_start;
+                data_start = 0;
+            }
+            if(buffer.size() < data_end + block_size)
+                buffer.resize(data_end + block_size);
+            stream.read(buffer.data() + data_end, block_size);
+            data_end += stream.gcount();
+            if(!stream)
+                stream_eof = true;
+        }
+
+//        Appends lines of [from, to) without surrounding whitespace to res
+        void appendLines(size_t from, size_t to, std::string &res) const {
+            res.reserve(res.size() + to - from);
+            size_t pos = from;
+            while(pos < to) {
+                const char *found = static_cast<const char *>(memchr(buffer.data() + pos, '\n', to - pos));
+                size_t line_end = found == nullptr ? to : found - buffer.data();
+                size_t next_pos = line_end + 1;
+                size_t line_start = pos;
+                trimSpan(line_start, line_end);
+                res.append(buffer.data() + line_start, line_end - line_start);
+                pos = next_pos;
+            }
+        }
+
+        StringContig makeContig(const RecordSpan &rec) const {
+            std::string id(buffer.data() + rec.header_begin, rec.header_end - rec.header_begin);
+            std::string seq;
+            appendLines(rec.seq_begin, rec.seq_end, seq);
+            if(filter != nullptr) {
+                std::string qual;
+                if(fastq)
+                    appendLines(rec.qual_begin, rec.qual_end, qual);
+                size_t from, to;
+                if(!filter->apply(qual, seq.size(), from, to))
+                    return {};
+                if(from > 0 || to < seq.size())
+                    seq = seq.substr(from, to - from);
+            }
+            return {std::move(seq), std::move(id)};
+        }
+
+        void buildRecords() {
+            parsed.clear();
+            parsed.resize(spans.size());
+            parsed_pos = 0;
+            size_t n = spans.size();
+            if(omp_in_parallel()) {
+#pragma omp taskloop grainsize(16)
+                for(size_t i = 0; i < n; i++) {
+                    parsed[i] = makeContig(spans[i]);
+                }
+            } else {
+                for(size_t i = 0; i < n; i++) {
+                    parsed[i] = makeContig(spans[i]);
+                }
+            }
+        }
+
+//        Parses next portion of complete records. Returns false if the stream is exhausted.
+        bool fill() {
+            spans.clear();
+            while(spans.empty()) {
+                ParseResult res = ParseResult::Incomplete;
+                size_t pos = data_start;
+                while(true) {
+                    RecordSpan rec{};
+                    size_t next = pos;
+                    res = parseRecord(pos, rec, next);
+                    if(res != ParseResult::Complete)
+                        break;
+                    if(rec.seq_end > rec.seq_begin)
+                        spans.emplace_back(rec);
+                    pos = next;
+                }
+                data_start = pos;
+                if(!spans.empty())
+                    break;
+                if(res == ParseResult::End)
+                    return false;
+                readBlock();
+            }
+            buildRecords();
+            return true;
+        }
+
+    public:
+        static const size_t default_block_size = size_t(1) << 24;
+
+        FastxParser(std::istream &_stream, bool _fastq, size_t _block_size = default_block_size,
+                    ReadFilter *_filter = nullptr) :
+                stream(_stream), fastq(_fastq), block_size(_block_size), filter(_filter) {
+        }
+
+        FastxParser(const FastxParser &) = delete;
+
+        bool next(StringContig &res) override {
+            while(true) {
+                if(parsed_pos == parsed.size() && !fill())
+                    return false;
+                res = std::move(parsed[parsed_pos]);
+                parsed_pos++;
+                if(filter == nullptr || !res.isNull())
+                    return true;
+            }
+        }
+    };
+}
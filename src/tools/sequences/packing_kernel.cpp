@@ -0,0 +1,207 @@
+#include "packing_kernel.hpp"
+#include "nucl.hpp"
+#include <algorithm>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace packing {
+    namespace scalar {
+        void Pack(const char *s, size_t n, uint64_t *words) {
+            for(size_t i = 0; i < Words(n); i++) {
+                uint64_t word = 0;
+                size_t len = std::min<size_t>(32, n - i * 32);
+                for(size_t j = 0; j < len; j++) {
+                    char code = dignucl(s[i * 32 + j]);
+                    word |= uint64_t(code == INVALID_NUCL ? 0 : code) << (j << 1u);
+                }
+                words[i] = word;
+            }
+        }
+
+        void Unpack(const uint64_t *words, size_t n, char *s) {
+            for(size_t i = 0; i < n; i++) {
+                s[i] = nucl((words[i >> 5u] >> ((i & 31u) << 1u)) & 3u);
+            }
+        }
+
+        void ReverseComplement(uint64_t *words, size_t n) {
+            std::vector<uint64_t> res(Words(n), 0);
+            for(size_t i = 0; i < n; i++) {
+                size_t j = n - 1 - i;
+                uint64_t code = 3u - ((words[j >> 5u] >> ((j & 31u) << 1u)) & 3u);
+                res[i >> 5u] |= code << ((i & 31u) << 1u);
+            }
+            std::copy(res.begin(), res.end(), words);
+        }
+    }
+
+    namespace {
+#if defined(__x86_64__)
+//        Low nibbles of A, C, G and T are 1, 3, 7 and 4 in both cases. Other characters with the same low nibble are
+//        packed as A like in scalar::Pack, and so are all other characters except codes 0-3, which are kept as is.
+        __attribute__((target("ssse3")))
+        inline __m128i CodeLookup() {
+            return _mm_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+        }
+
+        __attribute__((target("ssse3")))
+        inline __m128i Codes(__m128i chars, __m128i lookup) {
+            __m128i codes = _mm_shuffle_epi8(lookup, _mm_and_si128(chars, _mm_set1_epi8(0x0f)));
+            __m128i upper = _mm_and_si128(chars, _mm_set1_epi8(char(0xdf)));
+            __m128i letter = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(upper, _mm_set1_epi8('A')),
+                                                       _mm_cmpeq_epi8(upper, _mm_set1_epi8('C'))),
+                                          _mm_or_si128(_mm_cmpeq_epi8(upper, _mm_set1_epi8('G')),
+                                                       _mm_cmpeq_epi8(upper, _mm_set1_epi8('T'))));
+            __m128i digit = _mm_cmpeq_epi8(_mm_and_si128(chars, _mm_set1_epi8(char(0xfc))), _mm_setzero_si128());
+            return _mm_or_si128(_mm_and_si128(codes, letter), _mm_and_si128(chars, digit));
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i Codes(__m256i chars, __m256i lookup) {
+            __m256i codes = _mm256_shuffle_epi8(lookup, _mm256_and_si256(chars, _mm256_set1_epi8(0x0f)));
+            __m256i upper = _mm256_and_si256(chars, _mm256_set1_epi8(char(0xdf)));
+            __m256i letter = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(upper, _mm256_set1_epi8('A')),
+                                                             _mm256_cmpeq_epi8(upper, _mm256_set1_epi8('C'))),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(upper, _mm256_set1_epi8('G')),
+                                                             _mm256_cmpeq_epi8(upper, _mm256_set1_epi8('T'))));
+            __m256i digit = _mm256_cmpeq_epi8(_mm256_and_si256(chars, _mm256_set1_epi8(char(0xfc))),
+                                              _mm256_setzero_si256());
+            return _mm256_or_si256(_mm256_and_si256(codes, letter), _mm256_and_si256(chars, digit));
+        }
+
+//        16 characters to 32 bits: lookup of 2-bit codes, then pairs and quads are merged with multiply-add
+        __attribute__((target("ssse3")))
+        inline __m128i PackBlock(__m128i chars, __m128i lookup) {
+            __m128i codes = Codes(chars, lookup);
+            __m128i pairs = _mm_maddubs_epi16(codes, _mm_set1_epi16(0x0401));
+            return _mm_madd_epi16(pairs, _mm_set1_epi32(0x00100001));
+        }
+
+        __attribute__((target("ssse3")))
+        void PackSSSE3(const char *s, size_t n, uint64_t *words) {
+            const __m128i lookup = CodeLookup();
+            const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            size_t full = n / 32;
+            for(size_t i = 0; i < full; i++) {
+                __m128i lo = PackBlock(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i * 32)), lookup);
+                __m128i hi = PackBlock(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i * 32 + 16)), lookup);
+                words[i] = uint64_t(uint32_t(_mm_cvtsi128_si32(_mm_shuffle_epi8(lo, gather)))) |
+                           (uint64_t(uint32_t(_mm_cvtsi128_si32(_mm_shuffle_epi8(hi, gather)))) << 32u);
+            }
+            if(full * 32 < n)
+                scalar::Pack(s + full * 32, n - full * 32, words + full);
+        }
+
+        __attribute__((target("avx2")))
+        void PackAVX2(const char *s, size_t n, uint64_t *words) {
+            const __m256i lookup = _mm256_broadcastsi128_si256(CodeLookup());
+            const __m256i gather = _mm256_broadcastsi128_si256(
+                    _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+            size_t full = n / 32;
+            for(size_t i = 0; i < full; i++) {
+                __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i * 32));
+                __m256i codes = Codes(chars, lookup);
+                __m256i pairs = _mm256_maddubs_epi16(codes, _mm256_set1_epi16(0x0401));
+                __m256i quads = _mm256_shuffle_epi8(_mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00100001)), gather);
+                words[i] = uint64_t(uint32_t(_mm256_extract_epi32(quads, 0))) |
+                           (uint64_t(uint32_t(_mm256_extract_epi32(quads, 4))) << 32u);
+            }
+            if(full * 32 < n)
+                scalar::Pack(s + full * 32, n - full * 32, words + full);
+        }
+
+//        32 bits to 16 characters: every byte is split into its four 2-bit codes, the codes are interleaved back
+//        into nucleotide order and translated to characters with one lookup
+        __attribute__((target("ssse3")))
+        inline __m128i UnpackBlock(uint32_t bits, __m128i letters) {
+            const __m128i mask = _mm_set1_epi8(3);
+            __m128i v = _mm_cvtsi32_si128(int(bits));
+            __m128i c0 = _mm_and_si128(v, mask);
+            __m128i c1 = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+            __m128i c2 = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+            __m128i c3 = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+            __m128i codes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(c0, c1), _mm_unpacklo_epi8(c2, c3));
+            return _mm_shuffle_epi8(letters, codes);
+        }
+
+        __attribute__((target("ssse3")))
+        void UnpackSSSE3(const uint64_t *words, size_t n, char *s) {
+            const __m128i letters = _mm_setr_epi8('A', 'C', 'G', 'T', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+            size_t full = n / 32;
+            for(size_t i = 0; i < full; i++) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(s + i * 32), UnpackBlock(uint32_t(words[i]), letters));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(s + i * 32 + 16),
+                                 UnpackBlock(uint32_t(words[i] >> 32u), letters));
+            }
+            if(full * 32 < n)
+                scalar::Unpack(words + full, n - full * 32, s + full * 32);
+        }
+
+        bool HasSSSE3() {
+            static const bool res = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3"));
+            return res;
+        }
+
+        bool HasAVX2() {
+            static const bool res = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+            return res;
+        }
+#endif
+    }
+
+    void Pack(const char *s, size_t n, uint64_t *words) {
+#if defined(__x86_64__)
+        if(HasAVX2())
+            return PackAVX2(s, n, words);
+        if(HasSSSE3())
+            return PackSSSE3(s, n, words);
+#endif
+        scalar::Pack(s, n, words);
+    }
+
+    void Unpack(const uint64_t *words, size_t n, char *s) {
+#if defined(__x86_64__)
+        if(HasSSSE3())
+            return UnpackSSSE3(words, n, s);
+#endif
+        scalar::Unpack(words, n, s);
+    }
+
+//    Reversing whole words leaves 32 * words - n padding nucleotides in front, they are shifted out afterwards
+    void ReverseComplement(uint64_t *words, size_t n) {
+        size_t m = Words(n);
+        for(size_t i = 0, j = m; i < j; i++) {
+            j--;
+            uint64_t tmp = ReverseComplementWord(words[i]);
+            words[i] = ReverseComplementWord(words[j]);
+            words[j] = tmp;
+        }
+        size_t shift = (m * 32 - n) << 1u;
+        if(shift == 0)
+            return;
+        for(size_t i = 0; i < m; i++) {
+            words[i] >>= shift;
+            if(i + 1 < m)
+                words[i] |= words[i + 1] << (64 - shift);
+        }
+    }
+
+    void Extract(const uint64_t *src, size_t from, size_t n, uint64_t *words) {
+        if(n == 0)
+            return;
+        size_t m = Words(n);
+        src += from >> 5u;
+        size_t shift = (from & 31u) << 1u;
+        size_t last = ((from & 31u) + n - 1) >> 5u;
+        for(size_t i = 0; i < m; i++) {
+            uint64_t word = src[i] >> shift;
+            if(shift != 0 && i + 1 <= last)
+                word |= src[i + 1] << (64 - shift);
+            words[i] = word;
+        }
+        if((n & 31u) != 0)
+            words[m - 1] &= (uint64_t(1) << ((n & 31u) << 1u)) - 1;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Conversion between nucleotide characters and the 2-bit packed layout used by Sequence
+ * (nucleotide i is stored in bits 2i, 2i+1 of word i / 32, unused high bits of the last word are zero).
+ * Packing and unpacking use pshufb lookups (AVX2 or SSSE3, selected at runtime). Reverse complement works on whole
+ * words: complement is bitwise negation and the order of 2-bit pairs is reversed with a byte swap and two shuffles.
+ * Characters other than ACGT (in any case) and codes 0-3 are packed as A, with the same result in vector and scalar code.
+ * The scalar namespace contains the per character implementations that are used on other architectures.
+ */
+namespace packing {
+    inline size_t Words(size_t length) {
+        return (length + 31) / 32;
+    }
+
+    void Pack(const char *s, size_t n, uint64_t *words);
+
+    void Unpack(const uint64_t *words, size_t n, char *s);
+
+    // Reverse complement of a 32-mer packed into one word
+    inline uint64_t ReverseComplementWord(uint64_t x) {
+        x = ~__builtin_bswap64(x);
+        x = ((x >> 4u) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4u);
+        return ((x >> 2u) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2u);
+    }
+
+    // In place reverse complement of n packed nucleotides
+    void ReverseComplement(uint64_t *words, size_t n);
+
+    // Copies n nucleotides starting from nucleotide from of src into words, starting from bit 0
+    void Extract(const uint64_t *src, size_t from, size_t n, uint64_t *words);
+
+    namespace scalar {
+        void Pack(const char *s, size_t n, uint64_t *words);
+
+        void Unpack(const uint64_t *words, size_t n, char *s);
+
+        void ReverseComplement(uint64_t *words, size_t n);
+    }
+}
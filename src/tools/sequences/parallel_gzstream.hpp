@@ -0,0 +1,253 @@
+#pragma once
+
+#include "common/verify.hpp"
+#include <omp.h>
+#include <zlib.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gzstream {
+    /*
+     * Helpers for BGZF files (blocked gzip used by samtools/htslib). Every block is a separate gzip member
+     * with BC extra subfield that stores compressed size of the block, so blocks can be found without
+     * decompression and inflated independently.
+     */
+    namespace bgzf {
+        const size_t header_size = 18;
+
+        inline size_t extractBlockSize(const unsigned char *header, size_t len) {
+            if(len < header_size || header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4) == 0)
+                return 0;
+            size_t xlen = header[10] | (size_t(header[11]) << 8u);
+            if(xlen != 6 || header[12] != 'B' || header[13] != 'C' || header[14] != 2 || header[15] != 0)
+                return 0;
+            return (header[16] | (size_t(header[17]) << 8u)) + 1;
+        }
+
+        inline bool isBgzf(const std::string &file_name) {
+            std::ifstream is(file_name, std::ios::binary);
+            unsigned char header[header_size];
+            is.read(reinterpret_cast<char *>(header), header_size);
+            return size_t(is.gcount()) == header_size && extractBlockSize(header, header_size) != 0;
+        }
+
+//        Reads next raw block from the stream. Returns false at the end of file and fails on corrupted input.
+        inline bool readBlock(std::istream &is, std::vector<char> &raw) {
+            raw.resize(header_size);
+            is.read(raw.data(), header_size);
+            if(is.gcount() == 0)
+                return false;
+            size_t block_size = extractBlockSize(reinterpret_cast<const unsigned char *>(raw.data()), is.gcount());
+            VERIFY_MSG(block_size >= header_size + 8, "Incorrect BGZF block header");
+            raw.resize(block_size);
+            is.read(raw.data() + header_size, block_size - header_size);
+            VERIFY_MSG(size_t(is.gcount()) == block_size - header_size, "Truncated BGZF block");
+            return true;
+        }
+
+//        Inflates a block read with readBlock and appends the result to out.
+        inline void inflateBlock(const std::vector<char> &raw, std::vector<char> &out) {
+            const unsigned char *data = reinterpret_cast<const unsigned char *>(raw.data());
+            size_t isize = data[raw.size() - 4] | (size_t(data[raw.size() - 3]) << 8u) |
+                           (size_t(data[raw.size() - 2]) << 16u) | (size_t(data[raw.size() - 1]) << 24u);
+            uint32_t crc = data[raw.size() - 8] | (uint32_t(data[raw.size() - 7]) << 8u) |
+                           (uint32_t(data[raw.size() - 6]) << 16u) | (uint32_t(data[raw.size() - 5]) << 24u);
+            size_t old_size = out.size();
+            out.resize(old_size + isize);
+            if(isize == 0)
+                return;
+            z_stream zs{};
+            VERIFY(inflateInit2(&zs, -15) == Z_OK);
+            zs.next_in = const_cast<Bytef *>(data + header_size);
+            zs.avail_in = raw.size() - header_size - 8;
+            zs.next_out = reinterpret_cast<Bytef *>(out.data() + old_size);
+            zs.avail_out = isize;
+            int res = inflate(&zs, Z_FINISH);
+            inflateEnd(&zs);
+            VERIFY_MSG(res == Z_STREAM_END && zs.avail_out == 0, "Failed to inflate BGZF block");
+            VERIFY_MSG(crc32(0, reinterpret_cast<const Bytef *>(out.data() + old_size), isize) == crc,
+                       "BGZF block checksum mismatch");
+        }
+    }
+
+    /*
+     * Input streambuf for gzipped files that decompresses data in a background thread ahead of the reader.
+     * Decompressed chunks are passed to the reader through a bounded queue. BGZF files are decompressed
+     * in batches of blocks that are inflated on several threads in parallel, any other gzip file is inflated
+     * by zlib in the background thread.
+     */
+    class parallel_gzstreambuf : public std::streambuf {
+    private:
+        static const size_t chunk_size = size_t(1) << 22;
+        static const size_t bgzf_batch = 64;
+        static const size_t max_queue_size = 4;
+
+        std::string file_name;
+        size_t threads;
+        std::deque<std::vector<char>> queue;
+        std::vector<char> current;
+        std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        bool finished = false;
+        bool stopped = false;
+        bool opened = false;
+        std::thread worker;
+
+//        Returns false if the reader is destroyed and decompression should stop.
+        bool push(std::vector<char> &&chunk) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this] { return stopped || queue.size() < max_queue_size; });
+            if(stopped)
+                return false;
+            queue.emplace_back(std::move(chunk));
+            not_empty.notify_one();
+            return true;
+        }
+
+        void finish() {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished = true;
+            not_empty.notify_one();
+        }
+
+        void decompressGzip() {
+            gzFile file = gzopen(file_name.c_str(), "rb");
+            if(file == nullptr) {
+                std::cerr << "Error: could not open file " << file_name << std::endl;
+                return;
+            }
+            gzbuffer(file, 1 << 20);
+            while(true) {
+                std::vector<char> chunk(chunk_size);
+                int num = gzread(file, chunk.data(), chunk_size);
+//                Truncated stream is reported by gzerror after the last portion of data is read
+                int err = Z_OK;
+                const char *msg = gzerror(file, &err);
+                VERIFY_MSG(num >= 0 && err == Z_OK, "Failed to decompress " + file_name + ": " + msg);
+                if(num == 0)
+                    break;
+                chunk.resize(num);
+                if(!push(std::move(chunk)))
+                    break;
+            }
+            gzclose(file);
+        }
+
+        void decompressBgzf() {
+            std::ifstream is(file_name, std::ios::binary);
+            std::vector<std::vector<char>> raw(bgzf_batch);
+            std::vector<std::vector<char>> inflated(bgzf_batch);
+            while(true) {
+                size_t cnt = 0;
+                while(cnt < bgzf_batch && bgzf::readBlock(is, raw[cnt]))
+                    cnt++;
+                if(cnt == 0)
+                    break;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+                for(size_t i = 0; i < cnt; i++) {
+                    inflated[i].clear();
+                    bgzf::inflateBlock(raw[i], inflated[i]);
+                }
+                std::vector<char> chunk;
+                size_t total = 0;
+                for(size_t i = 0; i < cnt; i++)
+                    total += inflated[i].size();
+                chunk.reserve(total);
+                for(size_t i = 0; i < cnt; i++)
+                    chunk.insert(chunk.end(), inflated[i].begin(), inflated[i].end());
+                if(!chunk.empty() && !push(std::move(chunk)))
+                    break;
+            }
+        }
+
+    public:
+        explicit parallel_gzstreambuf(size_t _threads = std::min<size_t>(8, omp_get_max_threads())) :
+                threads(std::max<size_t>(_threads, 1)) {
+        }
+
+        parallel_gzstreambuf(const parallel_gzstreambuf &) = delete;
+
+        parallel_gzstreambuf *open(const char *name) {
+            if(opened)
+                return nullptr;
+            std::ifstream test(name, std::ios::binary);
+            if(!test.is_open())
+                return nullptr;
+            file_name = name;
+            opened = true;
+            bool blocked = bgzf::isBgzf(file_name);
+            worker = std::thread([this, blocked]() {
+                if(blocked)
+                    decompressBgzf();
+                else
+                    decompressGzip();
+                finish();
+            });
+            return this;
+        }
+
+        bool is_open() const {
+            return opened;
+        }
+
+        void close() {
+            if(!opened)
+                return;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stopped = true;
+                not_full.notify_all();
+            }
+            worker.join();
+            queue.clear();
+            opened = false;
+        }
+
+        ~parallel_gzstreambuf() override {
+            close();
+        }
+
+    protected:
+        int underflow() override {
+            if(gptr() != nullptr && gptr() < egptr())
+                return traits_type::to_int_type(*gptr());
+            if(!opened)
+                return traits_type::eof();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                not_empty.wait(lock, [this] { return finished || !queue.empty(); });
+                if(queue.empty())
+                    return traits_type::eof();
+                current = std::move(queue.front());
+                queue.pop_front();
+                not_full.notify_one();
+            }
+            setg(current.data(), current.data(), current.data() + current.size());
+            return traits_type::to_int_type(*gptr());
+        }
+    };
+
+    class parallel_igzstream : public std::istream {
+    private:
+        parallel_gzstreambuf buf;
+    public:
+        explicit parallel_igzstream(const char *name) : std::istream(nullptr) {
+            std::istream::rdbuf(&buf);
+            if(buf.open(name) == nullptr)
+                setstate(std::ios::badbit);
+        }
+
+        parallel_gzstreambuf *rdbuf() {
+            return &buf;
+        }
+    };
+}
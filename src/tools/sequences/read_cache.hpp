@@ -0,0 +1,181 @@
+#pragma once
+
+#include "fastx_parser.hpp"
+#include "contigs.hpp"
+#include "common/mmap_utils.hpp"
+#include <experimental/filesystem>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace io {
+    /*
+     * Binary cache of a read library. Reads are stored homopolymer and dimer compressed and 2-bit packed
+     * in the same word layout as Sequence uses, so that the library is parsed and compressed only once per run.
+     * File layout (all integers are little endian 64-bit, all sections are 8-byte aligned):
+     *   header (ReadCacheHeader), fingerprint of the source library,
+     *   packed bodies of all reads in input order,
+     *   index with one ReadCacheEntry per read, concatenated read names.
+     * Files with read_cache_extension are recognized by SeqReader, so a cache can be used as an io::Library.
+     */
+    const std::string read_cache_extension = ".lrc";
+
+    typedef std::vector<std::experimental::filesystem::path> Library;
+
+    struct ReadCacheHeader {
+        static constexpr uint64_t MAGIC = 0x454843414352414cull; // "LARCACHE"
+        static constexpr uint64_t VERSION = 1;
+        uint64_t magic = MAGIC;
+        uint64_t version = VERSION;
+        uint64_t reads = 0;
+        uint64_t bases = 0;
+        uint64_t index_offset = 0;
+        uint64_t names_offset = 0;
+        uint64_t homopolymer_compressing = 0;
+        uint64_t min_dimer_to_compress = 0;
+        uint64_t max_dimer_size = 0;
+        uint64_t dimer_step = 0;
+        uint64_t fingerprint_size = 0;
+
+        bool sameCompression() const {
+            return homopolymer_compressing == uint64_t(StringContig::homopolymer_compressing) &&
+                   min_dimer_to_compress == StringContig::min_dimer_to_compress &&
+                   max_dimer_size == StringContig::max_dimer_size && dimer_step == StringContig::dimer_step;
+        }
+    };
+
+    struct ReadCacheEntry {
+        uint64_t offset;
+        uint64_t length;
+        uint64_t name_offset;
+        uint64_t name_length;
+    };
+
+    inline size_t ReadCacheWords(size_t length) {
+        return (length + 31) / 32;
+    }
+
+//    Identifies the contents of a library so that a stale cache is not reused.
+    inline std::string LibraryFingerprint(const Library &lib) {
+        std::stringstream ss;
+        for(const std::experimental::filesystem::path &path : lib) {
+            ss << std::experimental::filesystem::absolute(path).string() << "\t"
+               << std::experimental::filesystem::file_size(path) << "\t"
+               << std::experimental::filesystem::last_write_time(path).time_since_epoch().count() << "\n";
+        }
+        return ss.str();
+    }
+
+//    Checks that all sections and all records of the index lie inside the file, e.g. that the file was not truncated
+    inline bool ReadCacheLayoutValid(const char *data, size_t size) {
+        if(size < sizeof(ReadCacheHeader))
+            return false;
+        const ReadCacheHeader &header = *reinterpret_cast<const ReadCacheHeader *>(data);
+        if(header.magic != ReadCacheHeader::MAGIC || header.version != ReadCacheHeader::VERSION)
+            return false;
+        const size_t bodies_offset = sizeof(ReadCacheHeader) + header.fingerprint_size;
+        if(header.fingerprint_size > size || bodies_offset > header.index_offset || header.index_offset % 8 != 0 ||
+           header.index_offset > size || header.reads > (size - header.index_offset) / sizeof(ReadCacheEntry) ||
+           header.names_offset != header.index_offset + header.reads * sizeof(ReadCacheEntry))
+            return false;
+        const ReadCacheEntry *index = reinterpret_cast<const ReadCacheEntry *>(data + header.index_offset);
+        const size_t names_size = size - header.names_offset;
+        uint64_t bases = 0;
+        for(size_t i = 0; i < header.reads; i++) {
+            const ReadCacheEntry &entry = index[i];
+            if(entry.offset < bodies_offset || entry.offset % 8 != 0 || entry.offset > header.index_offset ||
+               ReadCacheWords(entry.length) > (header.index_offset - entry.offset) / sizeof(uint64_t) ||
+               entry.name_offset > names_size || entry.name_length > names_size - entry.name_offset)
+                return false;
+            bases += entry.length;
+        }
+        return bases == header.bases;
+    }
+
+    inline bool ReadCacheHeaderValid(const std::experimental::filesystem::path &file, ReadCacheHeader &header,
+                                     std::string *fingerprint = nullptr) {
+        if(!std::experimental::filesystem::is_regular_file(file))
+            return false;
+        MappedFile mapped(file);
+        if(!ReadCacheLayoutValid(mapped.data(), mapped.size()))
+            return false;
+        header = *reinterpret_cast<const ReadCacheHeader *>(mapped.data());
+        if(fingerprint != nullptr)
+            *fingerprint = std::string(mapped.data() + sizeof(ReadCacheHeader), header.fingerprint_size);
+        return true;
+    }
+
+    /*
+     * Read cache mapped into memory. Reads are accessed by their index in the library and returned as Sequence
+     * views that point directly into the mapped file, so the library is not loaded into RAM and processes
+     * reading the same cache share the page cache.
+     */
+    class MappedReadStore {
+    private:
+        std::shared_ptr<const MappedFile> file;
+        const ReadCacheHeader *header;
+        const ReadCacheEntry *index;
+        const char *names;
+    public:
+        explicit MappedReadStore(const std::experimental::filesystem::path &path, bool sequential = false) :
+                file(std::make_shared<MappedFile>(path, sequential)) {
+            VERIFY_MSG(ReadCacheLayoutValid(file->data(), file->size()), "Incorrect read cache file " + path.string());
+            header = reinterpret_cast<const ReadCacheHeader *>(file->data());
+            VERIFY_MSG(header->sameCompression(), "Read cache " + path.string() + " was built with different compression parameters");
+            index = reinterpret_cast<const ReadCacheEntry *>(file->data() + header->index_offset);
+            names = file->data() + header->names_offset;
+        }
+
+        size_t size() const {
+            return header->reads;
+        }
+
+        size_t totalLength() const {
+            return header->bases;
+        }
+
+        Sequence get(size_t i) const {
+            const ReadCacheEntry &entry = index[i];
+            return Sequence::View(reinterpret_cast<const uint64_t *>(file->data() + entry.offset), entry.length, file);
+        }
+
+//        Full header line of the read, i.e. id followed by the comment
+        std::string name(size_t i) const {
+            return {names + index[i].name_offset, index[i].name_length};
+        }
+
+        std::string id(size_t i) const {
+            std::string res = name(i);
+            return res.substr(0, res.find(' '));
+        }
+
+        Contig contig(size_t i) const {
+            return {get(i), id(i)};
+        }
+    };
+
+    /*
+     * Sequential reader of the cache used by SeqReader. Produces compressed StringContig records that are marked as
+     * such, so makeSequence does not compress them again.
+     */
+    class ReadCacheParser : public RecordSource {
+    private:
+        MappedReadStore store;
+        size_t cur = 0;
+    public:
+        explicit ReadCacheParser(const std::experimental::filesystem::path &file) : store(file, true) {
+        }
+
+        bool next(StringContig &res) override {
+            if(cur == store.size())
+                return false;
+            res = StringContig(store.get(cur).str(), store.name(cur));
+            res.compressed = true;
+            cur++;
+            return true;
+        }
+    };
+}
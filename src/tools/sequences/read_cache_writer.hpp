@@ -0,0 +1,109 @@
+#pragma once
+
+#include "seqio.hpp"
+#include "read_cache.hpp"
+#include "common/logging.hpp"
+#include "common/omp_utils.hpp"
+#include <experimental/filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace io {
+    inline void WriteReadCache(logging::Logger &logger, const Library &lib,
+                               const std::experimental::filesystem::path &file, size_t threads, ReadFilter &filter) {
+        logging::TimeSpace t;
+        logger.info() << "Writing compressed read cache to " << file << std::endl;
+        std::experimental::filesystem::path tmp = file.string() + ".tmp";
+        std::ofstream os(tmp, std::ios::binary);
+        ReadCacheHeader header;
+        header.homopolymer_compressing = StringContig::homopolymer_compressing;
+        header.min_dimer_to_compress = StringContig::min_dimer_to_compress;
+        header.max_dimer_size = StringContig::max_dimer_size;
+        header.dimer_step = StringContig::dimer_step;
+        std::string fingerprint = LibraryFingerprint(lib) + filter.description();
+        header.fingerprint_size = fingerprint.size();
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        os.write(fingerprint.data(), fingerprint.size());
+        size_t offset = sizeof(header) + fingerprint.size();
+        const char zeros[8] = {};
+        os.write(zeros, (8 - offset % 8) % 8);
+        offset += (8 - offset % 8) % 8;
+        std::vector<ReadCacheEntry> index;
+        std::string names;
+        SeqReader reader(lib, filter);
+        const size_t batch_bases = size_t(1) << 28;
+        std::vector<StringContig> batch;
+        std::vector<std::vector<uint64_t>> packed;
+        std::vector<size_t> lengths;
+        while(!reader.eof()) {
+            batch.clear();
+            size_t bases = 0;
+            while(!reader.eof() && bases < batch_bases) {
+                batch.emplace_back(reader.read());
+                bases += batch.back().size();
+            }
+            packed.resize(batch.size());
+            lengths.resize(batch.size());
+#pragma omp parallel for schedule(dynamic, 16) num_threads(threads)
+            for(size_t i = 0; i < batch.size(); i++) {
+                lengths[i] = batch[i].compressPacked(packed[i]);
+                packed[i].resize(ReadCacheWords(lengths[i]));
+            }
+            for(size_t i = 0; i < batch.size(); i++) {
+                std::string name = batch[i].comment.empty() ? batch[i].id : batch[i].id + " " + batch[i].comment;
+                index.push_back({offset, lengths[i], names.size(), name.size()});
+                names += name;
+                os.write(reinterpret_cast<const char *>(packed[i].data()), packed[i].size() * sizeof(uint64_t));
+                offset += packed[i].size() * sizeof(uint64_t);
+                header.bases += lengths[i];
+            }
+        }
+        header.reads = index.size();
+        header.index_offset = offset;
+        os.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(ReadCacheEntry));
+        header.names_offset = offset + index.size() * sizeof(ReadCacheEntry);
+        os.write(names.data(), names.size());
+        os.seekp(0);
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        os.close();
+        VERIFY_MSG(bool(os), "Failed to write read cache " + tmp.string());
+        std::experimental::filesystem::rename(tmp, file);
+        if(filter.enabled())
+            filter.report(logger.info());
+        logger.info() << "Read cache contains " << header.reads << " reads with total length " << header.bases
+                      << " after compression" << std::endl;
+        cout << "WriteReadCache time: " << t.get() << endl;
+    }
+
+//    Checks that the read cache was built from lib with the same compression and filter settings
+    inline bool ReadCacheUpToDate(const Library &lib, const std::experimental::filesystem::path &file,
+                                  const ReadFilter &filter) {
+        ReadCacheHeader header;
+        std::string fingerprint;
+        return ReadCacheHeaderValid(file, header, &fingerprint) && header.sameCompression() &&
+               fingerprint == LibraryFingerprint(lib) + filter.description();
+    }
+
+//    Returns library that consists of the read cache for lib. The cache is reused if it is up to date and was built
+//    with the same filter settings.
+    inline Library PrepareReadCache(logging::Logger &logger, const Library &lib,
+                                    const std::experimental::filesystem::path &file, size_t threads,
+                                    ReadFilter &filter) {
+        if(ReadCacheUpToDate(lib, file, filter)) {
+            logger.info() << "Using existing read cache " << file << std::endl;
+        } else {
+//            Stages of the pipeline run in forks, and OpenMP used in the parent before fork deadlocks in the child
+            runInFork([&logger, &lib, &file, threads, &filter]() {
+                WriteReadCache(logger, lib, file, threads, filter);
+            });
+        }
+        return {file};
+    }
+
+    inline Library PrepareReadCache(logging::Logger &logger, const Library &lib,
+                                    const std::experimental::filesystem::path &file, size_t threads) {
+        ReadFilter filter;
+        return PrepareReadCache(logger, lib, file, threads, filter);
+    }
+}
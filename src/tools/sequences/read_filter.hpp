@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+namespace io {
+    /*
+     * Quality and length filter that FastxParser applies to reads before they are compressed.
+     * Both ends of a read are trimmed while base quality is below trim_quality. The read is dropped if the rest is
+     * shorter than min_length or if its mean quality is below min_quality. Mean quality is computed from the mean error
+     * probability of the bases, so a few very bad bases are not hidden by the rest of the read.
+     * FASTA records have no qualities and are only filtered by length.
+     * Counters are updated by parser threads and contain exact totals once all reads have been parsed.
+     */
+    class ReadFilter {
+    private:
+        double error_probability[128];
+
+    public:
+        double min_quality;
+        size_t trim_quality;
+        size_t min_length;
+        std::atomic<size_t> reads{0};
+        std::atomic<size_t> bases{0};
+        std::atomic<size_t> passed_reads{0};
+        std::atomic<size_t> passed_bases{0};
+
+        explicit ReadFilter(double _min_quality = 0, size_t _trim_quality = 0, size_t _min_length = 0) :
+                min_quality(_min_quality), trim_quality(_trim_quality), min_length(_min_length) {
+            for(size_t i = 0; i < 128; i++) {
+                double q = i < 33 ? 0 : double(i - 33);
+                error_probability[i] = std::pow(10., -q / 10);
+            }
+        }
+
+        ReadFilter(const ReadFilter &) = delete;
+
+        bool enabled() const {
+            return min_quality > 0 || trim_quality > 0 || min_length > 0;
+        }
+
+//        Identifies filter settings in read cache fingerprints
+        std::string description() const {
+            if(!enabled())
+                return "";
+            std::stringstream ss;
+            ss << "filter\t" << min_quality << "\t" << trim_quality << "\t" << min_length << "\n";
+            return ss.str();
+        }
+
+        static size_t phred(char c) {
+            return c < 33 ? 0 : size_t(c - 33);
+        }
+
+//        qual is either empty or has the same length as the read. Returns false if the read should be dropped,
+//        otherwise [from, to) is the part of the read that should be kept.
+        bool apply(const std::string &qual, size_t length, size_t &from, size_t &to) {
+            reads++;
+            bases += length;
+            from = 0;
+            to = length;
+            if(qual.size() == length) {
+                while(from < to && phred(qual[from]) < trim_quality)
+                    from++;
+                while(to > from && phred(qual[to - 1]) < trim_quality)
+                    to--;
+            }
+            if(to - from < std::max<size_t>(min_length, 1))
+                return false;
+            if(min_quality > 0 && qual.size() == length) {
+                double error = 0;
+                for(size_t i = from; i < to; i++)
+                    error += error_probability[size_t(qual[i]) & 127u];
+                if(-10 * std::log10(error / double(to - from)) < min_quality)
+                    return false;
+            }
+            passed_reads++;
+            passed_bases += to - from;
+            return true;
+        }
+
+        template<class Stream>
+        void report(Stream &os) const {
+            os << "Read filter kept " << passed_reads << " of " << reads << " reads and " << passed_bases << " of "
+               << bases << " bases" << std::endl;
+        }
+    };
+}
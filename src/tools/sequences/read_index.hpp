@@ -0,0 +1,347 @@
+#pragma once
+
+#include "parallel_gzstream.hpp"
+#include "contigs.hpp"
+#include "read_cache.hpp"
+#include "read_filter.hpp"
+#include "common/string_utils.hpp"
+#include "common/verify.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <experimental/filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace io {
+    /*
+     * Index of read positions in FASTA and FASTQ files that allows to fetch reads by id in any order.
+     * Like samtools .fai it stores for every read its file and the offset and size of the whole record in
+     * uncompressed data. For BGZF files it also stores, like .gzi, the compressed and uncompressed offsets of every
+     * block, so a record is fetched by inflating only the blocks that contain it.
+     * Reads are identified by the part of the header before the first whitespace. If several reads have the same id,
+     * the first one is used. Plain gzip files can not be accessed randomly and are not indexable.
+     */
+    struct ReadLocation {
+        size_t file;
+        size_t offset;
+        size_t length;
+    };
+
+    class ReadIndex {
+    public:
+        struct FileInfo {
+            std::experimental::filesystem::path path;
+            bool fastq;
+            bool bgzf;
+//            Uncompressed and compressed offsets of BGZF blocks
+            std::vector<std::pair<size_t, size_t>> blocks;
+        };
+
+    private:
+//        Finds record boundaries in a stream of uncompressed data that is passed in chunks.
+//        FASTQ records follow the rules of FastxParser: sequence lines until '+' and then quality lines until
+//        quality is as long as the sequence.
+        class RecordScanner {
+        private:
+            enum class State {
+                Header, Seq, Qual
+            };
+
+            std::unordered_map<std::string, ReadLocation> &locations;
+            size_t file;
+            bool fastq;
+            State state = State::Header;
+            std::string id;
+            size_t start = 0;
+            size_t seq_len = 0;
+            size_t qual_len = 0;
+            std::string carry;
+            size_t offset = 0;
+
+            static size_t trimmedLength(const char *s, size_t len) {
+                while(len > 0 && std::isspace(static_cast<unsigned char>(s[len - 1])))
+                    len--;
+                return len;
+            }
+
+            void finish(size_t end) {
+                if(!id.empty())
+                    locations.emplace(std::move(id), ReadLocation{file, start, end - start});
+                id.clear();
+            }
+
+            void startRecord(const char *s, size_t len, size_t pos) {
+                start = pos;
+                size_t id_len = 1;
+                while(id_len < len && !std::isspace(static_cast<unsigned char>(s[id_len])))
+                    id_len++;
+                id.assign(s + 1, id_len - 1);
+            }
+
+//            Line [pos, next) of the data without the line break
+            void line(const char *s, size_t len, size_t pos, size_t next) {
+                len = trimmedLength(s, len);
+                if(!fastq) {
+                    if(len > 0 && s[0] == '>') {
+                        finish(pos);
+                        startRecord(s, len, pos);
+                    }
+                    return;
+                }
+                if(state == State::Header) {
+                    if(len > 0 && s[0] == '@') {
+                        startRecord(s, len, pos);
+                        seq_len = 0;
+                        state = State::Seq;
+                    }
+                } else if(state == State::Seq) {
+                    if(len > 0 && s[0] == '+') {
+                        qual_len = 0;
+                        state = State::Qual;
+                    } else {
+                        seq_len += len;
+                    }
+                } else {
+                    qual_len += len;
+                    if(qual_len >= seq_len || len == 0) {
+                        finish(next);
+                        state = State::Header;
+                    }
+                }
+            }
+
+        public:
+            RecordScanner(std::unordered_map<std::string, ReadLocation> &_locations, size_t _file, bool _fastq) :
+                    locations(_locations), file(_file), fastq(_fastq) {
+            }
+
+            void feed(const char *data, size_t n) {
+                size_t pos = 0;
+                while(pos < n) {
+                    const char *found = static_cast<const char *>(memchr(data + pos, '\n', n - pos));
+                    if(found == nullptr) {
+                        carry.append(data + pos, n - pos);
+                        break;
+                    }
+                    size_t line_end = found - data;
+                    size_t line_start = offset + pos - carry.size();
+                    if(carry.empty()) {
+                        line(data + pos, line_end - pos, line_start, offset + line_end + 1);
+                    } else {
+                        carry.append(data + pos, line_end - pos);
+                        line(carry.data(), carry.size(), line_start, offset + line_end + 1);
+                        carry.clear();
+                    }
+                    pos = line_end + 1;
+                }
+                offset += n;
+            }
+
+            void end() {
+                if(!carry.empty()) {
+                    line(carry.data(), carry.size(), offset - carry.size(), offset);
+                    carry.clear();
+                }
+                finish(offset);
+            }
+        };
+
+        std::vector<FileInfo> files;
+        std::unordered_map<std::string, ReadLocation> locations;
+
+        void indexPlain(size_t file_num) {
+            RecordScanner scanner(locations, file_num, files[file_num].fastq);
+            std::ifstream is(files[file_num].path, std::ios::binary);
+            std::vector<char> chunk(size_t(1) << 24);
+            while(is) {
+                is.read(chunk.data(), chunk.size());
+                scanner.feed(chunk.data(), is.gcount());
+            }
+            scanner.end();
+        }
+
+        void indexBgzf(size_t file_num, size_t threads) {
+            const size_t batch = 64;
+            FileInfo &info = files[file_num];
+            RecordScanner scanner(locations, file_num, info.fastq);
+            std::ifstream is(info.path, std::ios::binary);
+            std::vector<std::vector<char>> raw(batch);
+            std::vector<std::vector<char>> inflated(batch);
+            size_t compressed = 0;
+            size_t uncompressed = 0;
+            while(true) {
+                size_t cnt = 0;
+                while(cnt < batch && gzstream::bgzf::readBlock(is, raw[cnt]))
+                    cnt++;
+                if(cnt == 0)
+                    break;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+                for(size_t i = 0; i < cnt; i++) {
+                    inflated[i].clear();
+                    gzstream::bgzf::inflateBlock(raw[i], inflated[i]);
+                }
+                for(size_t i = 0; i < cnt; i++) {
+                    info.blocks.emplace_back(uncompressed, compressed);
+                    compressed += raw[i].size();
+                    uncompressed += inflated[i].size();
+                    scanner.feed(inflated[i].data(), inflated[i].size());
+                }
+            }
+            scanner.end();
+        }
+
+    public:
+        static bool IsFastq(const std::experimental::filesystem::path &path) {
+            return endsWith(path, "fastq") || endsWith(path, "fq") || endsWith(path, "fastq.gz") ||
+                   endsWith(path, "fq.gz");
+        }
+
+        static bool Indexable(const std::experimental::filesystem::path &path) {
+            if(endsWith(path, read_cache_extension))
+                return false;
+            return !endsWith(path, ".gz") || gzstream::bgzf::isBgzf(path);
+        }
+
+        static bool Indexable(const Library &lib) {
+            return std::all_of(lib.begin(), lib.end(), [](const std::experimental::filesystem::path &path) {
+                return Indexable(path);
+            });
+        }
+
+        explicit ReadIndex(const Library &lib, size_t threads = std::min<size_t>(8, omp_get_max_threads())) {
+            for(const std::experimental::filesystem::path &path : lib) {
+                VERIFY_MSG(Indexable(path), "Can not build random access index for " + path.string());
+                files.push_back({path, IsFastq(path), endsWith(path, ".gz"), {}});
+                if(files.back().bgzf)
+                    indexBgzf(files.size() - 1, threads);
+                else
+                    indexPlain(files.size() - 1);
+            }
+        }
+
+        ReadIndex(const ReadIndex &) = delete;
+
+        const ReadLocation *find(const std::string &id) const {
+            auto it = locations.find(id);
+            return it == locations.end() ? nullptr : &it->second;
+        }
+
+        const std::vector<FileInfo> &getFiles() const {
+            return files;
+        }
+
+        size_t size() const {
+            return locations.size();
+        }
+    };
+
+    /*
+     * Fetches reads by id using ReadIndex. Files are read with pread, so one reader can be used from many
+     * threads at the same time.
+     */
+    class RandomAccessReader {
+    private:
+        const ReadIndex &index;
+        std::vector<int> fds;
+
+        void readExact(int fd, char *buf, size_t len, size_t offset) const {
+            while(len > 0) {
+                ssize_t res = pread(fd, buf, len, offset);
+                VERIFY_MSG(res > 0, "Failed to read indexed reads");
+                buf += res;
+                len -= res;
+                offset += res;
+            }
+        }
+
+        std::string fetch(const ReadLocation &loc) const {
+            const ReadIndex::FileInfo &info = index.getFiles()[loc.file];
+            if(!info.bgzf) {
+                std::string res(loc.length, 0);
+                readExact(fds[loc.file], &res[0], loc.length, loc.offset);
+                return res;
+            }
+            auto it = std::upper_bound(info.blocks.begin(), info.blocks.end(),
+                                       std::make_pair(loc.offset, size_t(-1))) - 1;
+            size_t skip = loc.offset - it->first;
+            std::vector<char> raw;
+            std::vector<char> out;
+            while(out.size() < skip + loc.length) {
+                VERIFY(it != info.blocks.end());
+                size_t end = it + 1 == info.blocks.end() ? std::experimental::filesystem::file_size(info.path)
+                                                         : (it + 1)->second;
+                raw.resize(end - it->second);
+                readExact(fds[loc.file], raw.data(), raw.size(), it->second);
+                gzstream::bgzf::inflateBlock(raw, out);
+                ++it;
+            }
+            return {out.begin() + skip, out.begin() + skip + loc.length};
+        }
+
+    public:
+        explicit RandomAccessReader(const ReadIndex &_index) : index(_index) {
+            for(const ReadIndex::FileInfo &info : index.getFiles()) {
+                fds.push_back(open(info.path.c_str(), O_RDONLY));
+                VERIFY_MSG(fds.back() >= 0, "Failed to open " + info.path.string());
+            }
+        }
+
+        RandomAccessReader(const RandomAccessReader &) = delete;
+
+        ~RandomAccessReader() {
+            for(int fd : fds)
+                close(fd);
+        }
+
+//        Returns false if there is no read with this id or if it is dropped by the filter. Reads are trimmed by the
+//        filter in the same way as by FastxParser.
+        bool read(const std::string &id, StringContig &res, ReadFilter *filter = nullptr) const {
+            const ReadLocation *loc = index.find(id);
+            if(loc == nullptr)
+                return false;
+            std::string text = fetch(*loc);
+            bool fastq = index.getFiles()[loc->file].fastq;
+            size_t pos = text.find('\n');
+            std::string header = text.substr(1, pos == size_t(-1) ? size_t(-1) : pos - 1);
+            while(!header.empty() && std::isspace(static_cast<unsigned char>(header.back())))
+                header.pop_back();
+            std::string seq;
+            std::string qual;
+            bool in_qual = false;
+            while(pos < text.size()) {
+                pos++;
+                size_t line_end = std::min(text.find('\n', pos), text.size());
+                if(fastq && !in_qual && text[pos] == '+') {
+                    if(filter == nullptr)
+                        break;
+                    in_qual = true;
+                    pos = line_end;
+                    continue;
+                }
+                size_t from = pos;
+                size_t to = line_end;
+                while(from < to && std::isspace(static_cast<unsigned char>(text[from])))
+                    from++;
+                while(to > from && std::isspace(static_cast<unsigned char>(text[to - 1])))
+                    to--;
+                (in_qual ? qual : seq).append(text, from, to - from);
+                pos = line_end;
+            }
+            if(filter != nullptr) {
+                size_t from, to;
+                if(!filter->apply(qual, seq.size(), from, to))
+                    return false;
+                if(from > 0 || to < seq.size())
+                    seq = seq.substr(from, to - from);
+            }
+            res = StringContig(std::move(seq), std::move(header));
+            return true;
+        }
+    };
+}
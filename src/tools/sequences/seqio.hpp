@@ -1,21 +1,25 @@
 #pragma once
 
 #include "common/string_utils.hpp"
+#include "common/omp_utils.hpp"
 #include "stream.hpp"
+#include "parallel_gzstream.hpp"
 #include "contigs.hpp"
+#include "fastx_parser.hpp"
+#include "read_cache.hpp"
 #include <experimental/filesystem>
 #include <iterator>
 #include <string>
 #include <utility>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <algorithm>
 #include <utility>
 
 namespace io {
 
 
-    typedef std::vector<std::experimental::filesystem::path> Library;
-
     inline bool CheckLibrary(const Library &lib) {
         bool res = true;
         for(const std::experimental::filesystem::path &path : lib) {
@@ -92,6 +96,124 @@ namespace io {
         }
     };
 
+//    Opens parser for a single library file. stream receives the input stream that the parser reads from, if any.
+    inline std::unique_ptr<RecordSource> OpenRecordSource(const std::experimental::filesystem::path &file_name,
+                                                          std::unique_ptr<std::istream> &stream,
+                                                          ReadFilter *filter = nullptr) {
+        if(!std::experimental::filesystem::is_regular_file(file_name)) {
+            std::cerr << "Error: file does not exist " << file_name << std::endl;
+        }
+        VERIFY(std::experimental::filesystem::is_regular_file(file_name));
+        if (endsWith(file_name, read_cache_extension)) {
+            return std::unique_ptr<RecordSource>(new ReadCacheParser(file_name));
+        }
+        bool fastq;
+        if (endsWith(file_name, ".gz")) {
+            stream.reset(new gzstream::parallel_igzstream(file_name.c_str()));
+            fastq = endsWith(file_name, "fastq.gz") or endsWith(file_name, "fq.gz");
+        } else {
+            stream.reset(new std::ifstream(file_name));
+            fastq = endsWith(file_name, "fastq") or endsWith(file_name, "fq");
+        }
+        return std::unique_ptr<RecordSource>(new FastxParser(*stream, fastq, FastxParser::default_block_size, filter));
+    }
+
+    /*
+     * Reads several files of a library at the same time. Every file is parsed by its own decoder thread that passes
+     * batches of records through a bounded queue. Records are returned in library order, file after file, so their
+     * numbering is the same as with sequential reading. At most max_active files are decoded ahead of the reader.
+     * Decoder threads are not inside an omp parallel region, so every file is parsed serially by its decoder.
+     * BGZF files are still inflated in parallel by parallel_igzstream with its own number of threads.
+     */
+    class MultiFileSource : public RecordSource {
+    private:
+        typedef std::vector<StringContig> Batch;
+        static const size_t batch_bases = size_t(1) << 24;
+        static const size_t queue_size = 2;
+
+        struct Decoder {
+            BoundedQueue<Batch> queue;
+            std::thread thread;
+
+            Decoder() : queue(queue_size) {
+            }
+        };
+
+        Library lib;
+        ReadFilter *filter;
+        size_t max_active;
+        std::vector<std::unique_ptr<Decoder>> decoders;
+        size_t current = 0;
+        Batch batch;
+        size_t batch_pos = 0;
+
+        void start(size_t file_num) {
+            Decoder &decoder = *decoders[file_num];
+            const std::experimental::filesystem::path &file_name = lib[file_num];
+            ReadFilter *file_filter = filter;
+            decoder.thread = std::thread([&decoder, &file_name, file_filter]() {
+                std::unique_ptr<std::istream> stream;
+                std::unique_ptr<RecordSource> parser = OpenRecordSource(file_name, stream, file_filter);
+                Batch next;
+                size_t bases = 0;
+                StringContig contig;
+                while(parser->next(contig)) {
+                    bases += contig.size();
+                    next.emplace_back(std::move(contig));
+                    if(bases >= batch_bases) {
+                        if(!decoder.queue.push(std::move(next)))
+                            return;
+                        next = Batch();
+                        bases = 0;
+                    }
+                }
+                if(!next.empty())
+                    decoder.queue.push(std::move(next));
+                decoder.queue.close();
+            });
+        }
+
+        void finish(size_t file_num) {
+            decoders[file_num]->queue.close();
+            decoders[file_num]->thread.join();
+            decoders[file_num].reset();
+        }
+
+    public:
+        explicit MultiFileSource(Library _lib, ReadFilter *_filter = nullptr, size_t _max_active = 8) :
+                lib(std::move(_lib)), filter(_filter), max_active(std::max<size_t>(1, std::min(_max_active, lib.size()))) {
+            for(size_t i = 0; i < lib.size(); i++)
+                decoders.emplace_back(new Decoder());
+            for(size_t i = 0; i < max_active; i++)
+                start(i);
+        }
+
+        MultiFileSource(const MultiFileSource &) = delete;
+
+        ~MultiFileSource() override {
+            for(size_t i = current; i < lib.size() && i < current + max_active; i++)
+                finish(i);
+        }
+
+        bool next(StringContig &res) override {
+            while(batch_pos == batch.size()) {
+                if(current == lib.size())
+                    return false;
+                batch.clear();
+                batch_pos = 0;
+                if(!decoders[current]->queue.pop(batch)) {
+                    finish(current);
+                    if(current + max_active < lib.size())
+                        start(current + max_active);
+                    current++;
+                }
+            }
+            res = std::move(batch[batch_pos]);
+            batch_pos++;
+            return true;
+        }
+    };
+
     //    TODO: Deal with corrupted files, comments in read names
     class SeqReader {
     public:
@@ -100,7 +222,7 @@ namespace io {
 
         void choose_next_pos(size_t start) {
             cur_start = start;
-            if(next.size() > start + 2 * min_read_size - overlap) {
+            if(split_reads && next.size() > start + 2 * min_read_size - overlap) {
                 cur_end = start + min_read_size;
             } else {
                 cur_end = next.size();
@@ -108,43 +230,15 @@ namespace io {
         }
 
         void inner_read() {
+            consumed = true;
             if(cur_end > 0 && cur_end < next.size()) {
                 choose_next_pos(cur_end - overlap);
                 return;
             }
-            while (stream != nullptr){
-                std::string id, seq;
-                std::getline(*stream, id);
-                std::getline(*stream, seq);
-                trim(seq);
-                if (!id.empty() and !seq.empty()) {
-                    std::stringstream ss;
-                    ss << seq;
-                    size_t cnt = 0;
-                    while(stream->peek() != EOF && stream->peek() != '>' && stream->peek() != '+') {
-                        std::getline(*stream, seq);
-                        trim(seq);
-                        if (seq.empty()) {
-                            next = {};
-                            break;
-                        }
-                        ss << seq;
-                        cnt += 1;
-                    }
-                    next = {ss.str(), std::move(trim(id.substr(1, id.size() - 1)))};
+            while (parser != nullptr){
+                if(parser->next(next)) {
                     choose_next_pos(0);
                     cur_start = 0;
-                    if(fastq) {
-                        std::getline(*stream, id);
-                        size_t qlen= 0;
-                        while(!stream->eof() && qlen < next.size()) {
-                            std::getline(*stream, seq);
-                            trim(seq);
-                            qlen += seq.size();
-                            if (seq.empty())
-                                break;
-                        }
-                    }
                     return;
                 }
                 nextFile();
@@ -154,56 +248,77 @@ namespace io {
         }
 
         void nextFile() {
-            delete stream;
-            if (file_it == lib.end()) {
-                stream = nullptr;
-            } else {
-                std::experimental::filesystem::path file_name = *file_it;
-                if(!std::experimental::filesystem::is_regular_file(file_name)) {
-                    std::cerr << "Error: file does not exist " << file_name << std::endl;
-                }
-                VERIFY(std::experimental::filesystem::is_regular_file(file_name));
-                if (endsWith(file_name, ".gz")) {
-                    stream = new gzstream::igzstream(file_name.c_str());
-                    fastq = endsWith(file_name, "fastq.gz") or endsWith(file_name, "fq.gz");
-                } else {
-                    stream = new std::ifstream(file_name);
-                    fastq = endsWith(file_name, "fastq") or endsWith(file_name, "fq");
-                }
+            parser.reset();
+            stream.reset();
+            if (file_it != lib.end()) {
+                parser = OpenRecordSource(*file_it, stream, filter);
                 ++file_it;
             }
         }
 
         const Library lib;
         Library::const_iterator file_it;
-        std::istream * stream{};
-        bool fastq{};
-        size_t min_read_size;
-        size_t overlap;
+        std::unique_ptr<std::istream> stream;
+        std::unique_ptr<RecordSource> parser;
+        ReadFilter *filter = nullptr;
+        bool split_reads = false;
+        size_t min_read_size = 0;
+        size_t overlap = 0;
         StringContig next{};
         size_t cur_start = 0;
         size_t cur_end = 0;
+        bool consumed = false;
     public:
         friend class ContigIterator<SeqReader>;
         friend class SeqIterator<SeqReader>;
 
-        explicit SeqReader(Library _lib, size_t _min_read_size = size_t(-1) / 2, size_t _overlap = size_t(-1) / 8) :
-                lib(std::move(_lib)), file_it(lib.begin()), min_read_size(_min_read_size), overlap(_overlap) {
+        explicit SeqReader(Library _lib) : lib(std::move(_lib)), file_it(lib.begin()) {
+            reset();
+        }
+
+//        Reads longer than 2 * min_read_size - overlap are returned as pieces of length min_read_size that overlap
+//        by overlap nucleotides
+        SeqReader(Library _lib, size_t _min_read_size, size_t _overlap = size_t(-1) / 8) :
+                lib(std::move(_lib)), file_it(lib.begin()), split_reads(true), min_read_size(_min_read_size),
+                overlap(_overlap) {
             VERIFY(min_read_size >= overlap * 2);
             reset();
         }
 
-        explicit SeqReader(const std::experimental::filesystem::path & file_name,
-                           size_t _min_read_size = size_t(-1) / 2, size_t _overlap = size_t(-1) / 8) :
-                           SeqReader(Library({file_name}), _min_read_size, _overlap) {
+//        Reads from FASTA and FASTQ files are passed through filter. Read caches are not filtered again.
+        SeqReader(Library _lib, ReadFilter &_filter) : lib(std::move(_lib)), file_it(lib.begin()), filter(&_filter) {
+            reset();
+        }
+
+        explicit SeqReader(const std::experimental::filesystem::path & file_name) :
+                           SeqReader(Library({file_name})) {
         }
 
+        SeqReader(const std::experimental::filesystem::path & file_name, size_t _min_read_size,
+                  size_t _overlap = size_t(-1) / 8) : SeqReader(Library({file_name}), _min_read_size, _overlap) {
+        }
+
+//        Libraries with several files are read by MultiFileSource
         void reset() {
-            file_it = lib.begin();
-            nextFile();
+            parser.reset();
+            stream.reset();
+            if(lib.size() > 1) {
+                parser.reset(new MultiFileSource(lib, filter));
+                file_it = lib.end();
+            } else {
+                file_it = lib.begin();
+                nextFile();
+            }
             cur_start = 0;
             cur_end = 0;
             inner_read();
+            consumed = false;
+        }
+
+        bool onlyReadCaches() const {
+            return std::all_of(lib.begin(), lib.end(), [](const std::experimental::filesystem::path &path) {
+                return endsWith(path, read_cache_extension);
+            });
         }
 
         SeqReader(SeqReader &&other) = default;
@@ -235,7 +350,9 @@ namespace io {
         StringContig get() {
             StringContig tmp;
             if(cur_start != 0 || cur_end != next.size()) {
-                return StringContig(next.seq.substr(cur_start, cur_end - cur_start), next.id + "_" + std::to_string(cur_start));
+                StringContig res(next.seq.substr(cur_start, cur_end - cur_start), next.id + "_" + std::to_string(cur_start));
+                res.compressed = next.compressed;
+                return std::move(res);
             } else {
                 return std::move(next);
             }
@@ -255,8 +372,21 @@ namespace io {
             return std::move(res);
         }
 
+//        Reads from read cache are returned as views into the mapped cache files without copying them to heap.
         std::vector<Contig> readAllContigs() {
             std::vector<Contig> res;
+            if(!consumed && onlyReadCaches() && !split_reads) {
+                for(const std::experimental::filesystem::path &path : lib) {
+                    MappedReadStore store(path);
+                    for(size_t i = 0; i < store.size(); i++) {
+                        res.emplace_back(store.contig(i));
+                    }
+                }
+                parser.reset();
+                file_it = lib.end();
+                next = StringContig();
+                return std::move(res);
+            }
             while(!eof()) {
                 res.emplace_back(read().makeContig());
             }
@@ -266,10 +396,6 @@ namespace io {
         bool eof() {
             return next.isNull();
         }
-
-        ~SeqReader() {
-            delete stream;
-        }
     };
 
 }
@@ -3,6 +3,7 @@
 #include "common/oneline_utils.hpp"
 #include "common/output_utils.hpp"
 #include "nucl.hpp"
+#include "packing_kernel.hpp"
 #include "IntrusiveRefCntPtr.h"
 #include "common/verify.hpp"
 #include <functional>
@@ -46,15 +47,22 @@ class Sequence {
             std::uninitialized_copy(buf, buf + Sequence::DataSize(nucls), data());
         }
 
+        // Non-owning buffer. Memory is kept alive by owner, e.g. a memory mapped file.
+        ManagedNuclBuffer(const ST *buf, std::shared_ptr<const void> owner) :
+                _data(const_cast<ST *>(buf)), _owner(std::move(owner)) {
+        }
+
     private:
         ST *_data;
+        std::shared_ptr<const void> _owner;
     public:
         const ST *data() const { return _data; }
 
         ST *data() { return _data; }
 
         ~ManagedNuclBuffer() {
-            delete[] _data;
+            if(!_owner)
+                delete[] _data;
         }
 
     };
@@ -80,6 +88,13 @@ class Sequence {
         // Which symbols does our string contain : 0123 or ACGT?
         bool digit_str = size_ == 0 || is_dignucl(s[0]);
 
+        if (!digit_str) {
+            packing::Pack(reinterpret_cast<const char *>(&s[0]), size_, bytes);
+            if (rc)
+                packing::ReverseComplement(bytes, size_);
+            return;
+        }
+
         // data -- one temporary variable corresponding to the i-th array element
         // and some counters
         ST data = 0;
@@ -88,8 +103,7 @@ class Sequence {
 
         if (rc) {
             for (int i = (int) size_ - 1; i >= 0; --i) {
-                //VERIFY(is_dignucl(s[i]) || is_nucl(s[i]));
-                char c = complement(digit_str ? s[(unsigned) i] : dignucl(s[(unsigned) i]));
+                char c = complement(s[(unsigned) i]);
 
                 data = data | (ST(c) << cnt);
                 cnt += 2;
@@ -102,8 +116,7 @@ class Sequence {
             }
         } else {
             for (size_t i = 0; i < size_; ++i) {
-                //VERIFY(is_dignucl(s[i]) || is_nucl(s[i]));
-                char c = digit_str ? s[i] : dignucl(s[i]);
+                char c = s[i];
 
                 data = data | (ST(c) << cnt);
                 cnt += 2;
@@ -126,6 +139,9 @@ class Sequence {
     Sequence(size_t size, int)
             : from_(0), size_(size), rtl_(false), data_(new ManagedNuclBuffer(size_)) {}
 
+    Sequence(size_t size, ManagedNuclBuffer *buffer)
+            : from_(0), size_(size), rtl_(false), data_(buffer) {}
+
     //Low level constructor. Handle with care.
     Sequence(const Sequence &seq, size_t from, size_t size, bool rtl)
             : from_(from), size_(size), rtl_(rtl), data_(seq.data_) {}
@@ -169,6 +185,20 @@ public:
     Sequence(const Sequence &s)
             : Sequence(s, s.from_, s.size_, s.rtl_) {}
 
+    /**
+     * Sequence that points to 2-bit packed data stored elsewhere without copying it.
+     * Data must use the same layout as Sequence (nucleotide i is stored in bits 2i, 2i+1 of word i / 32).
+     * owner is kept alive while this sequence or any of its subsequences exist.
+     */
+    static Sequence View(const u_int64_t *data, size_t size, std::shared_ptr<const void> owner) {
+        return Sequence(size, new ManagedNuclBuffer(data, std::move(owner)));
+    }
+
+    // Copies 2-bit packed data in the same layout as View expects.
+    static Sequence FromPacked(const u_int64_t *data, size_t size) {
+        return Sequence(size, new ManagedNuclBuffer(size, const_cast<ST *>(data)));
+    }
+
     static Sequence Concat(const std::vector<Sequence> &v) {
         std::stringstream ss;
         for(const auto &seq : v) {
@@ -192,7 +222,19 @@ public:
     Sequence &operator=(Sequence &&other) = default;
 
     Sequence copy() const {
-        return Sequence(str());
+        Sequence res(size_, 0);
+        copyPacked(res.data_->data());
+        return res;
+    }
+
+    /**
+     * Writes the sequence 2-bit packed in its own orientation to words, which must have packing::Words(size()) elements.
+     * Reverse complement views are flipped with word-level operations instead of nucleotide by nucleotide.
+     */
+    void copyPacked(u_int64_t *words) const {
+        packing::Extract(data_->data(), from_, size_, words);
+        if (rtl_)
+            packing::ReverseComplement(words, size_);
     }
 
     unsigned char operator[](const size_t index) const {
@@ -397,8 +439,12 @@ Sequence Sequence::operator+(const Sequence &s) const {
 std::string Sequence::str() const {
     VERIFY(size_ < 1000000000000ull);
     std::string res(size_, '-');
-    for (size_t i = 0; i < size_; ++i) {
-        res[i] = nucl(this->operator[](i));
+    if (!rtl_ && (from_ & (STN - 1u)) == 0) {
+        packing::Unpack(data_->data() + (from_ >> STNBits), size_, &res[0]);
+    } else {
+        std::vector<ST> words(DataSize(size_));
+        copyPacked(words.data());
+        packing::Unpack(words.data(), size_, &res[0]);
     }
     return res;
 }